@@ -24,7 +24,10 @@
 
 /** Model Wrapper */
 #include <Model.h>
+#include <ModelLoader.h>
 #include <Primitives.h>
+#include <UploadRing.h>
+#include <SceneGraph.h>
 
 
 
@@ -114,8 +117,14 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void glfw_onFramebufferSize(GLFWwindow* window, int width, int height);
 void showFPS(GLFWwindow* window);
 bool initOpenGL();
+void buildScene();
 void renderScene(Shader & shader);
 
+// Placements of the models, set up once by buildScene
+SceneGraph scene;
+int farmhouseNode, warehouseNode, countryhouseNode, nanosuitNode, sphereNode;
+int fanNodes[4];
+
 // Models
 std::shared_ptr<Model>
 objectCountryhouseModel,
@@ -145,12 +154,28 @@ int main() {
 	//Model objectNanosuit("Resources/nanosuit/nanosuit.obj");
 	//Model objectSphere("Resources/sphere/sphere.obj");
 
-	objectCountryhouseModel = std::make_shared<Model>("Resources/CountryHouse/house.obj");
-	objectWarehouseModel = std::make_shared<Model>("Resources/warehouse/warehouse.obj");
-	objectFarmhouseModel = std::make_shared<Model>("Resources/farmhouse/farmhouse.obj");
-	objectIndustrialFansModel = std::make_shared<Model>("Resources/IndustrialFans/IndustrialFans.obj");
-	objectNanosuit = std::make_shared<Model>("Resources/nanosuit/nanosuit.obj");
-	objectSphere = std::make_shared<Model>("Resources/sphere/sphere.obj");
+	// Imported side by side, built here as each one finishes
+	ModelLoader loader;
+	unsigned int countryhouse = loader.Submit("Resources/CountryHouse/house.obj", false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GPU_ONLY);
+	unsigned int warehouse = loader.Submit("Resources/warehouse/warehouse.obj", false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GPU_ONLY);
+	unsigned int farmhouse = loader.Submit("Resources/farmhouse/farmhouse.obj", false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GPU_ONLY);
+	unsigned int industrialFans = loader.Submit("Resources/IndustrialFans/IndustrialFans.obj", false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GPU_ONLY);
+	unsigned int nanosuit = loader.Submit("Resources/nanosuit/nanosuit.obj", false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GPU_ONLY);
+	unsigned int sphere = loader.Submit("Resources/sphere/sphere.obj", false, MODEL_OPTIMIZE_MESH | MODEL_GPU_ONLY);
+	loader.Finish();
+
+	objectCountryhouseModel = loader.Get(countryhouse);
+	objectWarehouseModel = loader.Get(warehouse);
+	objectFarmhouseModel = loader.Get(farmhouse);
+	objectIndustrialFansModel = loader.Get(industrialFans);
+	objectNanosuit = loader.Get(nanosuit);
+	objectSphere = loader.Get(sphere);
+	buildScene();
+
+	// Textures past this fall back to low mips until they are drawn again
+	SetTextureBudget(256 * 1024 * 1024);
+	// Mips stream in over the first frames instead of stalling one
+	SetTextureUploadBudget(8 * 1024 * 1024);
 
 	// Shader loader
 	Shader objectShader("shaders/demo.vert", "shaders/demo.frag");
@@ -212,10 +237,14 @@ int main() {
 
 		// Display FPS on title
 		showFPS(gWindow);
+		ResetTextureUploads();
 
 		// Key input
 		processInput(gWindow);
 
+		// World matrices of the nodes moved since the last frame
+		scene.Update();
+
 
 
 		// Camera transformations
@@ -266,14 +295,7 @@ int main() {
 		glBindTexture(GL_TEXTURE_2D, framebuffer.TID());
 		sphereShader.setUniform("sphereMap", 3);
 
-		float degree = (float) glfwGetTime() * glm::radians(10.0f);
-
-		glm::mat4 modelMatrix;
-		modelMatrix = glm::mat4(1.0f);
-		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 0.0f, 25.0f));
-		modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		//modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f, 0.2f, 0.2f));
-		sphereShader.setUniform("uModel", modelMatrix);
+		sphereShader.setUniform("uModel", scene.World(sphereNode));
 		objectSphere.get()->Draw(sphereShader);
 
 		renderScene(objectShader);
@@ -283,6 +305,7 @@ int main() {
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		glfwPollEvents();
 		glfwSwapBuffers(gWindow);
+		EndUploadFrame();
 	}
 	
 	glfwTerminate();
@@ -290,46 +313,68 @@ int main() {
 	return 0;
 }
 
-void renderScene(Shader & shader) {
+void buildScene() {
 
 	glm::mat4 modelMatrix;
 
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, glm::vec3(-30.0f, -5.0f, 0.0f));
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	shader.use();
-	shader.setUniform("uModel", modelMatrix);
-	objectFarmhouseModel.get()->Draw(shader);
-	
+	farmhouseNode = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "farmhouse");
+
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, glm::vec3(30.0f, 0.0f, 0.0f));
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(2.0f, 2.0f, 2.0f));
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	shader.use();
-	shader.setUniform("uModel", modelMatrix);
-	objectWarehouseModel.get()->Draw(shader);
+	warehouseNode = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "warehouse");
 
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, glm::vec3(10.0f, -5.0f, 0.0f));
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(0.002f, 0.002f, 0.002f));
-	//modelMatrix = glm::rotate(modelMatrix, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	shader.use();
-	shader.setUniform("uModel", modelMatrix);
-	objectCountryhouseModel.get()->Draw(shader);
+	countryhouseNode = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "countryhouse");
 
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, glm::vec3(-4.0f, -1.0f, 25.0f));
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f, 0.2f, 0.2f));
+	nanosuitNode = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "nanosuit");
+
+	// A row of fans, moved as one through their parent
+	modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-34.0f, -3.5f, 17.0f));
+	int fans = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "fans");
+	for (int i=0; i<4; i++) {
+		modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(i * 2.5f, 0.0f, 0.0f));
+		fanNodes[i] = scene.AddNode(fans, modelMatrix);
+	}
+
+	modelMatrix = glm::mat4(1.0f);
+	modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 0.0f, 25.0f));
+	modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	sphereNode = scene.AddNode(SceneGraph::NO_PARENT, modelMatrix, "sphere");
+
+	scene.Update();
+}
+
+void renderScene(Shader & shader) {
+
+	shader.use();
+	shader.setUniform("uModel", scene.World(farmhouseNode));
+	objectFarmhouseModel.get()->Draw(shader);
+	
+	shader.use();
+	shader.setUniform("uModel", scene.World(warehouseNode));
+	objectWarehouseModel.get()->Draw(shader);
+
+	shader.use();
+	shader.setUniform("uModel", scene.World(countryhouseNode));
+	objectCountryhouseModel.get()->Draw(shader);
+
 	shader.use();
-	shader.setUniform("uModel", modelMatrix);
+	shader.setUniform("uModel", scene.World(nanosuitNode));
 	objectNanosuit.get()->Draw(shader);
 
 	for (int i=0; i<4; i++) {
-		modelMatrix = glm::mat4(1.0f);
-		glm::vec3 FansPosition(-34.0f + i * 2.5f, -3.5f, 17.0f);
-		modelMatrix = glm::translate(modelMatrix, FansPosition);
 		shader.use();
-		shader.setUniform("uModel", modelMatrix);
+		shader.setUniform("uModel", scene.World(fanNodes[i]));
 		objectIndustrialFansModel.get()->Draw(shader);
 	}
 }
@@ -500,10 +545,15 @@ void showFPS(GLFWwindow* window)
 		// The C++ way of setting the window title
 		std::ostringstream outs;
 		outs.precision(3);	// decimal places
+		TextureResidencyStats textures = GetTextureResidencyStats();
+		UploadStats uploads = GetUploadStats();
 		outs << std::fixed
 			<< APP_TITLE << "    "
 			<< "FPS: " << fps << "    "
-			<< "Frame Time: " << msPerFrame << " (ms)";
+			<< "Frame Time: " << msPerFrame << " (ms)    "
+			<< "Textures: " << textures.current / (1024 * 1024) << " / " << textures.budget / (1024 * 1024)
+			<< " MB (peak " << textures.peak / (1024 * 1024) << ")    "
+			<< "Upload: " << uploads.frameBytes / 1024 << " KB, stall " << uploads.frameStallMs << " (ms)";
 		glfwSetWindowTitle(window, outs.str().c_str());
 
 		// Reset for next average.
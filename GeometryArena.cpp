@@ -0,0 +1,374 @@
+#include <GeometryArena.h>
+#include <VertexFormat.h>
+#include <Mesh.h>
+#include <UploadRing.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+
+/** Blocks start at these sizes and double per block of a layout, up to the max */
+static const size_t BLOCK_VERTEX_BYTES     =  4 << 20;
+static const size_t BLOCK_INDEX_BYTES      =  2 << 20;
+static const size_t BLOCK_MAX_VERTEX_BYTES = 64 << 20;
+static const size_t BLOCK_MAX_INDEX_BYTES  = 32 << 20;
+
+/** Index ranges are kept 4-byte aligned so 16 and 32-bit indices can share a buffer */
+static const size_t INDEX_ALIGNMENT = 4;
+
+typedef std::map<size_t, size_t> FreeList; // offset -> size
+
+struct ArenaBlock {
+	GLuint vao, vbo, ebo;
+	size_t vertexCapacity; // vertices
+	size_t indexCapacity;  // bytes
+	FreeList vertexFree;   // in vertices
+	FreeList indexFree;    // in bytes
+};
+
+struct ArenaAllocation {
+	unsigned int layout;
+	unsigned int block;
+	size_t vertexOffset; // vertices
+	size_t numVertices;  // reserved, at least 1
+	size_t indexOffset;  // bytes
+	size_t indexBytes;   // reserved, aligned
+};
+
+static std::vector<ArenaBlock> arenaBlocks[NUM_ARENA_LAYOUTS];
+static SlotArray<ArenaAllocation, GeometryTag> arenaAllocations; // live allocations only
+static GLuint arenaBoundVao = 0;
+
+static size_t LayoutStride(unsigned int layout) {
+	return layout == ARENA_PIXEL_LAYOUT ? sizeof(Pixel) : VertexSize((VertexFormat) layout);
+}
+
+static void SetupLayoutAttributes(unsigned int layout) {
+	if (layout != ARENA_PIXEL_LAYOUT) {
+		SetupVertexAttributes((VertexFormat) layout);
+		return;
+	}
+	glEnableVertexAttribArray(0); // vertex positions
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Pixel), NULL);
+	glEnableVertexAttribArray(1); // vertex texture coords
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Pixel), (void*)offsetof(Pixel, texCoords));
+}
+
+/*************************************************
+* Free lists
+*************************************************/
+
+static bool FindFit(const FreeList & free, size_t size, size_t & offset) {
+	for (const auto & range : free) {
+		if (range.second < size) continue;
+		offset = range.first;
+		return true;
+	}
+	return false;
+}
+
+// offset must be the start of a free range found by FindFit
+static void TakeRange(FreeList & free, size_t offset, size_t size) {
+	FreeList::iterator it = free.find(offset);
+	size_t rest = it->second - size;
+	free.erase(it);
+	if (rest) free[offset + size] = rest;
+}
+
+static void ReturnRange(FreeList & free, size_t offset, size_t size) {
+	FreeList::iterator next = free.lower_bound(offset);
+	if (next != free.end() && offset + size == next->first) {
+		size += next->second;
+		next = free.erase(next);
+	}
+	if (next != free.begin()) {
+		FreeList::iterator prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+	free[offset] = size;
+}
+
+/*************************************************
+* Blocks
+*************************************************/
+
+static ArenaBlock CreateBlock(unsigned int layout, size_t numVertices, size_t indexBytes) {
+
+	size_t stride = LayoutStride(layout);
+	size_t grow = std::min(arenaBlocks[layout].size(), (size_t) 4);
+	size_t vertexBytes = std::min(BLOCK_VERTEX_BYTES << grow, BLOCK_MAX_VERTEX_BYTES);
+	size_t indexBlockBytes = std::min(BLOCK_INDEX_BYTES << grow, BLOCK_MAX_INDEX_BYTES);
+
+	ArenaBlock block;
+	block.vertexCapacity = std::max(numVertices, vertexBytes / stride);
+	block.indexCapacity  = std::max(indexBytes, indexBlockBytes);
+	block.vertexFree[0]  = block.vertexCapacity;
+	block.indexFree[0]   = block.indexCapacity;
+
+	glGenBuffers(1, &block.vbo);
+	glGenBuffers(1, &block.ebo);
+	glGenVertexArrays(1, &block.vao);
+
+	glBindVertexArray(block.vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, block.vbo);
+	glBufferData(GL_ARRAY_BUFFER, block.vertexCapacity * stride, NULL, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, block.indexCapacity, NULL, GL_STATIC_DRAW);
+
+	SetupLayoutAttributes(layout);
+
+	glBindVertexArray(0);
+	arenaBoundVao = 0;
+
+	return block;
+}
+
+static void Upload(GLuint buffer, size_t offset, size_t bytes, const void * data) {
+	StageBufferData(buffer, offset, data, bytes);
+}
+
+/*************************************************
+* Allocation
+*************************************************/
+
+GeometryHandle ArenaAllocate(unsigned int layout,
+	const void * vertexData, size_t numVertices,
+	const void * indexData, size_t indexBytes) {
+
+	if (layout >= NUM_ARENA_LAYOUTS) return GeometryHandle();
+
+	// Empty ranges still reserve a slot so every allocation owns a distinct offset
+	size_t vertexReserve = std::max(numVertices, (size_t) 1);
+	size_t indexReserve  = std::max((indexBytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT * INDEX_ALIGNMENT, INDEX_ALIGNMENT);
+
+	std::vector<ArenaBlock> & blocks = arenaBlocks[layout];
+
+	// First fit over the blocks of the layout, a new block when none has room
+	unsigned int b = 0;
+	size_t vertexOffset = 0, indexOffset = 0;
+	for (; b<blocks.size(); b++)
+		if (FindFit(blocks[b].vertexFree, vertexReserve, vertexOffset) &&
+			FindFit(blocks[b].indexFree, indexReserve, indexOffset))
+			break;
+	if (b == blocks.size()) {
+		blocks.push_back(CreateBlock(layout, vertexReserve, indexReserve));
+		vertexOffset = indexOffset = 0;
+	}
+
+	ArenaBlock & block = blocks[b];
+	TakeRange(block.vertexFree, vertexOffset, vertexReserve);
+	TakeRange(block.indexFree, indexOffset, indexReserve);
+
+	size_t stride = LayoutStride(layout);
+	Upload(block.vbo, vertexOffset * stride, numVertices * stride, vertexData);
+	Upload(block.ebo, indexOffset, indexBytes, indexData);
+
+	ArenaAllocation allocation = { layout, b, vertexOffset, vertexReserve, indexOffset, indexReserve };
+	GeometryHandle handle = arenaAllocations.Insert(allocation);
+	if (handle.IsNull()) {
+		ReturnRange(block.vertexFree, vertexOffset, vertexReserve);
+		ReturnRange(block.indexFree, indexOffset, indexReserve);
+	}
+	return handle;
+}
+
+void ArenaFree(GeometryHandle handle) {
+
+	const ArenaAllocation * allocation = arenaAllocations.Get(handle);
+	if (!allocation) return;
+
+	ArenaBlock & block = arenaBlocks[allocation->layout][allocation->block];
+	ReturnRange(block.vertexFree, allocation->vertexOffset, allocation->numVertices);
+	ReturnRange(block.indexFree, allocation->indexOffset, allocation->indexBytes);
+
+	arenaAllocations.Remove(handle);
+}
+
+bool ArenaUpdateIndices(GeometryHandle handle, const void * indexData, size_t indexBytes) {
+
+	const ArenaAllocation * allocation = arenaAllocations.Get(handle);
+	if (!allocation || indexBytes > allocation->indexBytes) return false;
+
+	const ArenaBlock & block = arenaBlocks[allocation->layout][allocation->block];
+	Upload(block.ebo, allocation->indexOffset, indexBytes, indexData);
+	return true;
+}
+
+ArenaRange ArenaGetRange(GeometryHandle handle) {
+
+	ArenaRange range = { 0, 0, 0, 0, 0 };
+	const ArenaAllocation * found = arenaAllocations.Get(handle);
+	if (!found) return range;
+
+	const ArenaAllocation & allocation = *found;
+	const ArenaBlock & block = arenaBlocks[allocation.layout][allocation.block];
+	range.vao = block.vao;
+	range.vbo = block.vbo;
+	range.ebo = block.ebo;
+	range.baseVertex  = (GLint) allocation.vertexOffset;
+	range.indexOffset = allocation.indexOffset;
+	return range;
+}
+
+bool ArenaBind(GeometryHandle handle) {
+	GLuint vao = ArenaGetRange(handle).vao;
+	if (vao == arenaBoundVao) return false;
+	glBindVertexArray(vao);
+	arenaBoundVao = vao;
+	return true;
+}
+
+void ArenaUnbind() {
+	glBindVertexArray(0);
+	arenaBoundVao = 0;
+}
+
+/*************************************************
+* Compaction
+*************************************************/
+
+// Source and destination may overlap, so go through a scratch buffer
+static void MoveRange(GLuint buffer, GLuint scratch, size_t from, size_t to, size_t bytes) {
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, bytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, bytes);
+}
+
+void ArenaCompact() {
+
+	GLuint scratch = 0;
+	size_t scratchBytes = 0;
+
+	for (unsigned int layout=0; layout<NUM_ARENA_LAYOUTS; layout++) {
+
+		std::vector<ArenaBlock> & blocks = arenaBlocks[layout];
+		size_t stride = LayoutStride(layout);
+
+		for (unsigned int b=0; b<blocks.size(); b++) {
+
+			ArenaBlock & block = blocks[b];
+			std::vector<ArenaAllocation *> live;
+			for (size_t i=0; i<arenaAllocations.Size(); i++) {
+				ArenaAllocation & allocation = arenaAllocations.At(i);
+				if (allocation.layout == layout && allocation.block == b)
+					live.push_back(&allocation);
+			}
+
+			// Largest range decides the scratch size
+			size_t needed = 0;
+			for (const ArenaAllocation * allocation : live)
+				needed = std::max(needed, std::max(allocation->numVertices * stride, allocation->indexBytes));
+			if (needed > scratchBytes) {
+				if (!scratch) glGenBuffers(1, &scratch);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+				glBufferData(GL_COPY_WRITE_BUFFER, needed, NULL, GL_STREAM_COPY);
+				scratchBytes = needed;
+			}
+
+			// Vertices, lowest offset first so a range never moves over a live one
+			std::sort(live.begin(), live.end(), [](const ArenaAllocation * a, const ArenaAllocation * b) {
+				return a->vertexOffset < b->vertexOffset;
+			});
+			size_t vertexEnd = 0;
+			for (ArenaAllocation * allocation : live) {
+				if (allocation->vertexOffset != vertexEnd)
+					MoveRange(block.vbo, scratch, allocation->vertexOffset * stride, vertexEnd * stride, allocation->numVertices * stride);
+				allocation->vertexOffset = vertexEnd;
+				vertexEnd += allocation->numVertices;
+			}
+
+			// Indices
+			std::sort(live.begin(), live.end(), [](const ArenaAllocation * a, const ArenaAllocation * b) {
+				return a->indexOffset < b->indexOffset;
+			});
+			size_t indexEnd = 0;
+			for (ArenaAllocation * allocation : live) {
+				if (allocation->indexOffset != indexEnd)
+					MoveRange(block.ebo, scratch, allocation->indexOffset, indexEnd, allocation->indexBytes);
+				allocation->indexOffset = indexEnd;
+				indexEnd += allocation->indexBytes;
+			}
+
+			// One free range at the tail of each buffer
+			block.vertexFree.clear();
+			block.indexFree.clear();
+			if (vertexEnd < block.vertexCapacity) block.vertexFree[vertexEnd] = block.vertexCapacity - vertexEnd;
+			if (indexEnd < block.indexCapacity) block.indexFree[indexEnd] = block.indexCapacity - indexEnd;
+		}
+
+		// Trailing blocks left empty give their storage back
+		while (!blocks.empty() &&
+			blocks.back().vertexFree.size() == 1 && blocks.back().vertexFree.begin()->second == blocks.back().vertexCapacity &&
+			blocks.back().indexFree.size() == 1 && blocks.back().indexFree.begin()->second == blocks.back().indexCapacity) {
+			ArenaBlock & block = blocks.back();
+			if (block.vao == arenaBoundVao) ArenaUnbind();
+			glDeleteVertexArrays(1, &block.vao);
+			glDeleteBuffers(1, &block.vbo);
+			glDeleteBuffers(1, &block.ebo);
+			blocks.pop_back();
+		}
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if (scratch) glDeleteBuffers(1, &scratch);
+}
+
+ArenaStats GetArenaStats() {
+
+	ArenaStats stats = { 0, 0, 0, 0, 0 };
+
+	for (unsigned int layout=0; layout<NUM_ARENA_LAYOUTS; layout++) {
+		size_t stride = LayoutStride(layout);
+		for (const ArenaBlock & block : arenaBlocks[layout]) {
+			stats.blocks++;
+			stats.capacityBytes += block.vertexCapacity * stride + block.indexCapacity;
+		}
+	}
+
+	for (size_t i=0; i<arenaAllocations.Size(); i++) {
+		const ArenaAllocation & allocation = arenaAllocations.At(i);
+		stats.allocations++;
+		stats.vertexBytes += allocation.numVertices * LayoutStride(allocation.layout);
+		stats.indexBytes  += allocation.indexBytes;
+	}
+
+	return stats;
+}
+
+/*************************************************
+* Handle
+*************************************************/
+
+ArenaHandle :: ArenaHandle(ArenaHandle && other) noexcept : handle(other.handle) {
+	other.handle = GeometryHandle();
+}
+
+ArenaHandle & ArenaHandle :: operator=(ArenaHandle && other) noexcept {
+	if (this != &other) {
+		Reset();
+		handle = other.handle;
+		other.handle = GeometryHandle();
+	}
+	return *this;
+}
+
+ArenaHandle :: ~ArenaHandle() {
+	Reset();
+}
+
+void ArenaHandle :: Reset() {
+	ArenaFree(handle);
+	handle = GeometryHandle();
+}
@@ -0,0 +1,88 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include <VertexFormat.h>
+#include <Handle.h>
+
+/**
+* Process-wide vertex and index storage shared by meshes and primitives.
+*
+* Every vertex layout owns a few large blocks, each one VBO + EBO + VAO. Geometry is
+* suballocated from them (first fit, adjacent free ranges coalesce) and drawn with
+* glDrawElementsBaseVertex, so consecutive draws of one layout need one VAO bind.
+* Allocations are referred to by generational handles, so a handle kept past
+* ArenaFree finds nothing instead of the range's next owner. Their offsets may
+* move on ArenaCompact, read them back with ArenaGetRange at draw time. GL thread only.
+*/
+
+// Layouts 0 .. NUM_VERTEX_FORMATS-1 are the Mesh VertexFormats
+const unsigned int ARENA_PIXEL_LAYOUT = NUM_VERTEX_FORMATS; // Pixel, used by Base2D
+const unsigned int NUM_ARENA_LAYOUTS  = NUM_VERTEX_FORMATS + 1;
+
+struct ArenaRange {
+	GLuint vao;
+	GLuint vbo;
+	GLuint ebo;
+	GLint  baseVertex;
+	size_t indexOffset; // bytes into the EBO
+};
+
+struct ArenaStats {
+	size_t blocks;
+	size_t allocations;
+	size_t vertexBytes;   // in use
+	size_t indexBytes;    // in use
+	size_t capacityBytes; // vertex + index buffer storage
+};
+
+/** Methods */
+
+// indexBytes of index data; returns a null handle on failure
+GeometryHandle ArenaAllocate(unsigned int layout,
+	const void * vertexData, size_t numVertices,
+	const void * indexData, size_t indexBytes);
+void ArenaFree(GeometryHandle handle);
+// Overwrite the indices of an allocation in place, false when they do not fit
+bool ArenaUpdateIndices(GeometryHandle handle, const void * indexData, size_t indexBytes);
+// All zero for stale handles
+ArenaRange ArenaGetRange(GeometryHandle handle);
+
+// Binds the VAO of an allocation unless it is already bound by the arena, returns
+// whether a bind was issued. Finish a run of draws with ArenaUnbind() so binds made
+// outside the arena are not mistaken for the arena's.
+bool ArenaBind(GeometryHandle handle);
+void ArenaUnbind();
+
+// Slide live allocations down to close holes left by ArenaFree
+void ArenaCompact();
+
+ArenaStats GetArenaStats();
+
+/**
+* Owns one allocation and frees it on destruction. Move-only, so classes holding
+* one (Mesh, Base2D, Base3D) can be moved into containers but never copied into
+* a double free.
+*/
+class ArenaHandle {
+public:
+	ArenaHandle() {}
+	explicit ArenaHandle(GeometryHandle handle) : handle(handle) {} // takes over an ArenaAllocate handle
+	ArenaHandle(ArenaHandle && other) noexcept;
+	ArenaHandle & operator=(ArenaHandle && other) noexcept;
+	~ArenaHandle();
+
+	GeometryHandle Id() const { return handle; }
+	void Reset(); // frees the allocation now
+
+private:
+	GeometryHandle handle;
+
+	ArenaHandle(const ArenaHandle &);
+	ArenaHandle & operator=(const ArenaHandle &);
+};
+
+#endif
@@ -198,6 +198,25 @@ int main() {
 
 
 
+	// Per-frame uniforms, resolved once
+	UniformHandle uEnableBlinn        = objectShader.uniformHandle("uEnableBlinn");
+	UniformHandle uEnableTorch        = objectShader.uniformHandle("uEnableTorch");
+	UniformHandle uEnableNormal       = objectShader.uniformHandle("uEnableNormal");
+	UniformHandle uGamma              = objectShader.uniformHandle("uGamma");
+	UniformHandle uHeightScale        = objectShader.uniformHandle("uHeightScale");
+	UniformHandle uReverseNormal      = objectShader.uniformHandle("uReverseNormal");
+	UniformHandle uView               = objectShader.uniformHandle("uView");
+	UniformHandle uProjection         = objectShader.uniformHandle("uProjection");
+	UniformHandle uCameraPos          = objectShader.uniformHandle("uCameraPos");
+	UniformHandle uSpotLightPosition  = objectShader.uniformHandle("uSpotLight.position");
+	UniformHandle uSpotLightDirection = objectShader.uniformHandle("uSpotLight.direction");
+	UniformHandle uModel              = objectShader.uniformHandle("uModel");
+	UniformHandle uHDRBuffer          = hdrShader.uniformHandle("uHDRBuffer");
+	UniformHandle uHDR                = hdrShader.uniformHandle("uHDR");
+	UniformHandle uExposure           = hdrShader.uniformHandle("uExposure");
+
+
+
 	// Camera global
 	float aspect = (float)gWindowWidth / (float)gWindowHeight;
 
@@ -233,19 +252,19 @@ int main() {
 
 		objectShader.use();
 
-		objectShader.setUniform("uEnableBlinn", use_blinn);
-		objectShader.setUniform("uEnableTorch", use_torch);
-		objectShader.setUniform("uEnableNormal", use_normal_tex);
-		objectShader.setUniform("uGamma", use_gamma);
-		objectShader.setUniform("uHeightScale", height_scale);
-		objectShader.setUniform("uReverseNormal", true);
+		objectShader.setUniform(uEnableBlinn, use_blinn);
+		objectShader.setUniform(uEnableTorch, use_torch);
+		objectShader.setUniform(uEnableNormal, use_normal_tex);
+		objectShader.setUniform(uGamma, use_gamma);
+		objectShader.setUniform(uHeightScale, height_scale);
+		objectShader.setUniform(uReverseNormal, true);
 
-		objectShader.setUniform("uView", view);
-		objectShader.setUniform("uProjection", projection);
-		objectShader.setUniform("uCameraPos", camera.position);
+		objectShader.setUniform(uView, view);
+		objectShader.setUniform(uProjection, projection);
+		objectShader.setUniform(uCameraPos, camera.position);
 
-		objectShader.setUniform("uSpotLight.position", camera.position);
-		objectShader.setUniform("uSpotLight.direction", camera.front);
+		objectShader.setUniform(uSpotLightPosition, camera.position);
+		objectShader.setUniform(uSpotLightDirection, camera.front);
 
 		glm::mat4 modelMatrix;
 
@@ -253,7 +272,7 @@ int main() {
 		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, 0.0f, 25.0f));
 		modelMatrix = glm::scale(modelMatrix, glm::vec3(5.0f, 5.0f, 55.0f));
 		objectShader.use();
-		objectShader.setUniform("uModel", modelMatrix);
+		objectShader.setUniform(uModel, modelMatrix);
 		objectCube.Draw(objectShader);
 
 		frameBuffer.Unbind();
@@ -266,9 +285,9 @@ int main() {
 		hdrShader.use();
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, frameBuffer.TID());
-		hdrShader.setUniform("uHDRBuffer", 0);
-		hdrShader.setUniform("uHDR", use_hdr);
-		hdrShader.setUniform("uExposure", use_exposure);
+		hdrShader.setUniform(uHDRBuffer, 0);
+		hdrShader.setUniform(uHDR, use_hdr);
+		hdrShader.setUniform(uExposure, use_exposure);
 		objectQuad.Draw(hdrShader);
 
 
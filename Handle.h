@@ -0,0 +1,161 @@
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/**
+* 32-bit generational handles into dense slot arrays.
+*
+* A handle is a slot index (low 20 bits) and the generation of that slot when
+* the handle was made (high 12 bits). Removing an item bumps the generation of
+* its slot, so handles still pointing at it go stale instead of reaching
+* whatever reuses the slot. Generations start at 1, the zero value is null.
+*
+* Items are stored densely: removal moves the last item into the hole, so
+* iteration only touches live items and the storage never fragments.
+*/
+
+template <typename Tag>
+struct Handle {
+	static const uint32_t INDEX_BITS = 20;
+	static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+	uint32_t value;
+
+	Handle() : value(0) {}
+	Handle(uint32_t index, uint32_t generation) : value((generation << INDEX_BITS) | index) {}
+
+	uint32_t Index() const { return value & INDEX_MASK; }
+	uint32_t Generation() const { return value >> INDEX_BITS; }
+	bool IsNull() const { return value == 0; }
+	bool operator==(const Handle & other) const { return value == other.value; }
+	bool operator!=(const Handle & other) const { return value != other.value; }
+};
+
+struct TextureTag;
+struct GeometryTag;
+struct ProgramTag;
+
+typedef Handle<TextureTag>  TextureHandle;  // Texture.h
+typedef Handle<GeometryTag> GeometryHandle; // GeometryArena.h
+typedef Handle<ProgramTag>  ProgramHandle;  // ShaderProgram.h
+
+template <typename T, typename Tag>
+class SlotArray {
+public:
+	typedef Handle<Tag> HandleType;
+
+	// Null when all 2^20 slots are in use
+	HandleType Insert(T item);
+	bool Remove(HandleType handle);
+	void Clear();
+
+	bool Alive(HandleType handle) const { return lookup(handle) != NONE; }
+	T * Get(HandleType handle);             // NULL when stale
+	const T * Get(HandleType handle) const;
+
+	/** Dense iteration, in no particular order */
+	size_t Size() const { return items.size(); }
+	T & At(size_t i) { return items[i]; }
+	const T & At(size_t i) const { return items[i]; }
+	HandleType HandleAt(size_t i) const;
+
+private:
+	static const uint32_t NONE = 0xFFFFFFFFu;
+
+	struct Slot {
+		uint32_t dense; // index into items, NONE when free
+		uint32_t generation;
+	};
+
+	std::vector<T> items;
+	std::vector<uint32_t> itemSlots; // slot of each item
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+
+	uint32_t lookup(HandleType handle) const;
+};
+
+/*************************************************
+* SlotArray
+*************************************************/
+
+template <typename T, typename Tag>
+Handle<Tag> SlotArray<T, Tag> :: Insert(T item) {
+
+	uint32_t slot;
+	if (!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	} else {
+		if (slots.size() > HandleType::INDEX_MASK) return HandleType();
+		slot = (uint32_t) slots.size();
+		Slot fresh = { NONE, 1 };
+		slots.push_back(fresh);
+	}
+
+	slots[slot].dense = (uint32_t) items.size();
+	items.push_back(std::move(item));
+	itemSlots.push_back(slot);
+	return HandleType(slot, slots[slot].generation);
+}
+
+template <typename T, typename Tag>
+bool SlotArray<T, Tag> :: Remove(HandleType handle) {
+
+	uint32_t dense = lookup(handle);
+	if (dense == NONE) return false;
+
+	// The last item fills the hole
+	uint32_t last = (uint32_t) items.size() - 1;
+	if (dense != last) {
+		items[dense] = std::move(items[last]);
+		itemSlots[dense] = itemSlots[last];
+		slots[itemSlots[dense]].dense = dense;
+	}
+	items.pop_back();
+	itemSlots.pop_back();
+
+	Slot & slot = slots[handle.Index()];
+	slot.dense = NONE;
+	slot.generation = (slot.generation + 1) & HandleType::GENERATION_MASK;
+	if (slot.generation == 0) slot.generation = 1;
+	freeSlots.push_back(handle.Index());
+	return true;
+}
+
+template <typename T, typename Tag>
+void SlotArray<T, Tag> :: Clear() {
+	while (!items.empty()) Remove(HandleAt(items.size() - 1));
+}
+
+template <typename T, typename Tag>
+T * SlotArray<T, Tag> :: Get(HandleType handle) {
+	uint32_t dense = lookup(handle);
+	return dense == NONE ? NULL : &items[dense];
+}
+
+template <typename T, typename Tag>
+const T * SlotArray<T, Tag> :: Get(HandleType handle) const {
+	uint32_t dense = lookup(handle);
+	return dense == NONE ? NULL : &items[dense];
+}
+
+template <typename T, typename Tag>
+Handle<Tag> SlotArray<T, Tag> :: HandleAt(size_t i) const {
+	uint32_t slot = itemSlots[i];
+	return HandleType(slot, slots[slot].generation);
+}
+
+template <typename T, typename Tag>
+uint32_t SlotArray<T, Tag> :: lookup(HandleType handle) const {
+	if (handle.IsNull() || handle.Index() >= slots.size()) return NONE;
+	const Slot & slot = slots[handle.Index()];
+	return slot.generation == handle.Generation() ? slot.dense : NONE;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/**
+* FNV-1a over 64-bit words, followed by the tail bytes.
+* Used for cache keys and lookup tables, not as a general purpose hash.
+*/
+inline uint64_t HashBytes(const void * bytes, size_t length, uint64_t seed = 14695981039346656037ULL) {
+
+	const uint64_t prime = 1099511628211ULL;
+	const unsigned char * p = (const unsigned char *) bytes;
+	uint64_t h = seed;
+
+	size_t words = length / sizeof(uint64_t);
+	for (size_t i=0; i<words; i++) {
+		uint64_t w;
+		std::memcpy(&w, p + i * sizeof(uint64_t), sizeof(uint64_t));
+		h = (h ^ w) * prime;
+	}
+
+	for (size_t i=words * sizeof(uint64_t); i<length; i++)
+		h = (h ^ p[i]) * prime;
+
+	return h;
+}
+
+#endif
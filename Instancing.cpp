@@ -23,6 +23,7 @@
 
 /** Model Wrapper */
 #include <Model.h>
+#include <ModelLoader.h>
 
 // Global Variables
 const char* APP_TITLE = "Advanced OpenGL - Instancing";
@@ -65,8 +66,12 @@ int main() {
 	//Model objectFarmhouseModel("Resources/farmhouse/farmhouse.obj");
 	//Model objectIndustrialFansModel("Resources/IndustrialFans/IndustrialFans.obj");
 	//Model objectNanosuit("Resources/nanosuit/nanosuit.obj");
-	Model objectPlanet("Resources/planet/planet.obj");
-	Model objectRock("Resources/rock/rock.obj");
+	ModelLoader loader;
+	unsigned int planet = loader.Submit("Resources/planet/planet.obj");
+	unsigned int rock = loader.Submit("Resources/rock/rock.obj");
+	loader.Finish();
+	Model & objectPlanet = *loader.Get(planet);
+	Model & objectRock = *loader.Get(rock);
 
 	// Shader loader
 	Shader objectShader, instanceShader;
@@ -150,10 +155,21 @@ int main() {
 	glBindBuffer(GL_ARRAY_BUFFER, ibo);
 	glBufferData(GL_ARRAY_BUFFER, cnt_obj * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
 
+	// Rock VBOs live in the shared geometry arena, so the instance attributes
+	// go into a VAO of their own instead of the arena one
+	std::vector<unsigned int> rockVAOs;
 	for (Mesh & mesh : objectRock.meshes) {
 
-		unsigned rockVAO = mesh.VAO();
+		unsigned int rockVAO;
+		glGenVertexArrays(1, &rockVAO);
 		glBindVertexArray(rockVAO);
+		rockVAOs.push_back(rockVAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO());
+		SetupVertexAttributes(mesh.Format());
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO());
+
+		glBindBuffer(GL_ARRAY_BUFFER, ibo);
 		size_t vec4Size = (int) sizeof(glm::vec4);
 
 		glEnableVertexAttribArray(3);
@@ -234,11 +250,12 @@ int main() {
 		// (1)
 		instanceShader.use();
 		instanceShader.setUniform("uMaterial.texture_diffuse1", 0);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, objectRock.textures_loaded[0].id);
-		for (Mesh & mesh : objectRock.meshes) {
-			glBindVertexArray(mesh.VAO());
-			glDrawElementsInstanced(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0, cnt_obj);
+		BindTexture(0, objectRock.textures_loaded[0].handle);
+		for (unsigned int i=0; i<objectRock.meshes.size(); i++) {
+			Mesh & mesh = objectRock.meshes[i];
+			glBindVertexArray(rockVAOs[i]);
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, mesh.NumIndices(), mesh.IndexType(),
+				(void*)mesh.IndexOffset(), cnt_obj, mesh.BaseVertex());
 			glBindVertexArray(0);
 		}
 		
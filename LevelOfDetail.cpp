@@ -0,0 +1,301 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+/** Basic GLFW header */
+//#include <GL/glew.h>	// Important - this header must come before glfw3 header
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+/** GLFW Math */
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+/** Shader Wrapper */
+#include <ShaderProgram.h>
+
+/** Camera Wrapper */
+#include <EularCamera.h>
+
+/** Model Wrapper */
+#include <Model.h>
+
+// Global Variables
+const char* APP_TITLE = "Level of Detail -- Flythrough";
+const int gWindowWidth = 1280;
+const int gWindowHeight = 720;
+GLFWwindow* gWindow = NULL;
+
+// Camera system
+Camera camera(glm::vec3(0.0f, 5.0f, 20.0f));
+
+// Flythrough: the camera travels down a street of models, once with LOD off
+// and once with LOD on, and the averages of each pass are printed.
+const float FLYTHROUGH_SECONDS = 20.0f;
+const float FLYTHROUGH_START = 20.0f;
+const float FLYTHROUGH_END = -200.0f;
+const int NUM_ROWS = 10;
+const float ROW_SPACING = 20.0f;
+
+bool use_lod = false;
+
+// Function prototypes
+void processInput(GLFWwindow* window);
+void glfw_onFramebufferSize(GLFWwindow* window, int width, int height);
+void showFPS(GLFWwindow* window);
+bool initOpenGL();
+
+//-----------------------------------------------------------------------------
+// Main Application Entry Point
+//-----------------------------------------------------------------------------
+int main() {
+
+	if (!initOpenGL()){
+		// An error occured
+		std::cerr << "GLFW initialization failed" << std::endl;
+		return -1;
+	}
+
+	// Model loader
+	unsigned int flags = MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_GENERATE_LODS;
+	Model objectFarmhouse("Resources/farmhouse/farmhouse.obj", false, flags);
+	Model objectNanosuit("Resources/nanosuit/nanosuit.obj", false, flags);
+	Model objectCyborg("Resources/cyborg/cyborg.obj", false, flags);
+
+	// Shader loader
+	Shader objectShader("shaders/demo.vert", "shaders/demo.frag");
+
+	// Object shader config
+	objectShader.use();
+	objectShader.setUniform("uDirectionalLight.direction", 1.0f, -1.0f, 0.0f);
+	objectShader.setUniform("uDirectionalLight.ambient", 0.5f, 0.5f, 0.5f);
+	objectShader.setUniform("uDirectionalLight.diffuse", 1.0f, 1.0f, 1.0f);
+	objectShader.setUniform("uDirectionalLight.specular", 1.0f, 1.0f, 1.0f);
+	objectShader.setUniform("uSpotLight.diffuse", 0.0f, 0.0f, 0.0f);
+	objectShader.setUniform("uSpotLight.specular", 0.0f, 0.0f, 0.0f);
+
+
+
+	// Camera global
+	float aspect = (float)gWindowWidth / (float)gWindowHeight;
+
+	// LOD on: per-mesh selection from the camera, LOD off: always full detail
+	auto drawModel = [&](Model & model, const glm::mat4 & modelMatrix) {
+		if (use_lod) {
+			model.Draw(objectShader, modelMatrix, camera);
+			return;
+		}
+		objectShader.use();
+		objectShader.setUniform("uModel", modelMatrix);
+		model.Draw(objectShader);
+	};
+
+	// Pass statistics
+	double passStart = glfwGetTime();
+	double lastFrame = passStart;
+	double frameTimeSum = 0.0;
+	size_t triangleSum = 0, drawCallSum = 0, vaoBindSum = 0;
+	unsigned int frames = 0;
+
+
+
+	// Rendering loop
+	while (!glfwWindowShouldClose(gWindow)) {
+
+		// Display FPS on title
+		showFPS(gWindow);
+
+		// Key input
+		processInput(gWindow);
+
+		// Clear the screen
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		ResetDrawStats();
+
+		// Scripted camera
+		float t = (float) (glfwGetTime() - passStart) / FLYTHROUGH_SECONDS;
+		camera.position = glm::vec3(0.0f, 5.0f, FLYTHROUGH_START + (FLYTHROUGH_END - FLYTHROUGH_START) * t);
+
+		// Camera transformations
+		glm::mat4 view = camera.getViewMatrix();
+		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), aspect, 0.1f, 500.0f);
+
+		objectShader.use();
+		objectShader.setUniform("uView", view);
+		objectShader.setUniform("uProjection", projection);
+		objectShader.setUniform("uCameraPos", camera.position);
+
+		// Render scene
+		for (int row=0; row<NUM_ROWS; row++) {
+
+			float z = -row * ROW_SPACING;
+			glm::mat4 modelMatrix;
+
+			modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(-30.0f, -5.0f, z));
+			modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			drawModel(objectFarmhouse, modelMatrix);
+
+			modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(-4.0f, -1.0f, z));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f, 0.2f, 0.2f));
+			drawModel(objectNanosuit, modelMatrix);
+
+			modelMatrix = glm::mat4(1.0f);
+			modelMatrix = glm::translate(modelMatrix, glm::vec3(10.0f, -5.0f, z));
+			modelMatrix = glm::scale(modelMatrix, glm::vec3(3.0f, 3.0f, 3.0f));
+			drawModel(objectCyborg, modelMatrix);
+		}
+
+
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwPollEvents();
+		glfwSwapBuffers(gWindow);
+
+		// Accumulate the pass
+		double now = glfwGetTime();
+		DrawStats stats = GetDrawStats();
+		frameTimeSum += now - lastFrame;
+		lastFrame = now;
+		triangleSum += stats.triangles;
+		drawCallSum += stats.drawCalls;
+		vaoBindSum += stats.vaoBinds;
+		frames++;
+
+		if (t >= 1.0f) {
+			std::cout << "LevelOfDetail: LOD " << (use_lod ? "on " : "off")
+				<< "  frames " << frames
+				<< "  frame time " << frameTimeSum * 1000.0 / frames << " ms"
+				<< "  triangles " << triangleSum / frames
+				<< "  draw calls " << drawCallSum / frames
+				<< "  vao binds " << vaoBindSum / frames << "\n";
+
+			use_lod = !use_lod;
+			passStart = now;
+			frameTimeSum = 0.0;
+			triangleSum = drawCallSum = vaoBindSum = 0;
+			frames = 0;
+		}
+	}
+
+	glfwTerminate();
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Initialize GLFW and OpenGL
+//-----------------------------------------------------------------------------
+bool initOpenGL() {
+
+	// Intialize GLFW
+	// GLFW is configured.  Must be called before calling any GLFW functions
+	if (!glfwInit()) {
+		// An error occured
+		std::cerr << "GLFW initialization failed" << std::endl;
+		return false;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// forward compatible with newer versions of OpenGL as they become available
+	// but not backward compatible (it will not run on devices that do not support OpenGL 3.3
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	// Create an OpenGL 3.3 core, forward compatible context window
+	gWindow = glfwCreateWindow(gWindowWidth, gWindowHeight, APP_TITLE, NULL, NULL);
+	if (gWindow == NULL) {
+		std::cerr << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+
+	// Make the window's context the current one
+	glfwMakeContextCurrent(gWindow);
+
+	// Frame time is the measurement, do not wait for vsync
+	glfwSwapInterval(0);
+
+	// Set the required callback functions
+	glfwSetFramebufferSizeCallback(gWindow, glfw_onFramebufferSize);
+
+	// Initialize GLAD: load all OpenGL function pointers
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+
+	// Configure global OpenGL state
+	glEnable(GL_DEPTH_TEST);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Is called whenever a key is pressed/released via GLFW
+//-----------------------------------------------------------------------------
+void processInput(GLFWwindow* window) {
+
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, GL_TRUE);
+
+	static bool gWireframe = false;
+	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+		gWireframe = !gWireframe;
+		if (gWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		else glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Is called when the window is resized
+//-----------------------------------------------------------------------------
+void glfw_onFramebufferSize(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
+
+//-----------------------------------------------------------------------------
+// Code computes the average frames per second, and also the average time it takes
+// to render one frame.  These stats are appended to the window caption bar.
+//-----------------------------------------------------------------------------
+void showFPS(GLFWwindow* window)
+{
+	static double previousSeconds = 0.0;
+	static int frameCount = 0;
+	double elapsedSeconds;
+	double currentSeconds = glfwGetTime(); // returns number of seconds since GLFW started, as double float
+
+	elapsedSeconds = currentSeconds - previousSeconds;
+
+	// Limit text updates to 4 times per second
+	if (elapsedSeconds > 0.25)
+	{
+		previousSeconds = currentSeconds;
+		double fps = (double)frameCount / elapsedSeconds;
+		double msPerFrame = 1000.0 / fps;
+
+		// The C++ way of setting the window title
+		std::ostringstream outs;
+		outs.precision(3);	// decimal places
+		outs << std::fixed
+			<< APP_TITLE << "    "
+			<< (use_lod ? "LOD on" : "LOD off") << "    "
+			<< "FPS: " << fps << "    "
+			<< "Frame Time: " << msPerFrame << " (ms)";
+		glfwSetWindowTitle(window, outs.str().c_str());
+
+		// Reset for next average.
+		frameCount = 0;
+	}
+
+	frameCount++;
+}
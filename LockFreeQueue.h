@@ -0,0 +1,63 @@
+#ifndef LOCKFREEQUEUE_H
+#define LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <utility>
+#include <cstddef>
+
+/**
+* Unbounded multi-producer single-consumer queue (Vyukov style).
+* Push may be called from any thread, Pop only from the consumer thread.
+*/
+
+template <typename T>
+class LockFreeQueue {
+public:
+	LockFreeQueue() : head(&stub), tail(&stub) {
+		stub.next.store(NULL, std::memory_order_relaxed);
+	}
+
+	~LockFreeQueue() {
+		T value;
+		while (Pop(value)) {}
+		if (tail != &stub) delete tail;
+	}
+
+	void Push(T value) {
+		Node * node = new Node;
+		node->value = std::move(value);
+		node->next.store(NULL, std::memory_order_relaxed);
+		Node * prev = head.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	bool Pop(T & value) {
+		Node * first = tail;
+		Node * next = first->next.load(std::memory_order_acquire);
+		if (next == NULL) return false;
+
+		value = std::move(next->value);
+		tail = next; // next becomes the new dummy node
+		if (first != &stub) delete first;
+		return true;
+	}
+
+	bool Empty() const {
+		return tail->next.load(std::memory_order_acquire) == NULL;
+	}
+
+private:
+	struct Node {
+		std::atomic<Node *> next;
+		T value;
+	};
+
+	std::atomic<Node *> head; // producers
+	Node * tail;              // consumer
+	Node stub;
+
+	LockFreeQueue(const LockFreeQueue &);
+	LockFreeQueue & operator=(const LockFreeQueue &);
+};
+
+#endif
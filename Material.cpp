@@ -0,0 +1,114 @@
+#include <Material.h>
+#include <Hash.h>
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+/*************************************************
+* Material
+*************************************************/
+
+Material :: Material() : key(HashBytes(NULL, 0)) {}
+
+Material :: Material(std::vector<Texture> textures, std::vector<TextureLayer> layers)
+	: textures(std::move(textures)), layers(std::move(layers)) {
+
+	key = HashBytes(NULL, 0);
+	unsigned int counts[TEX_AMBIENT + 1] = {};
+
+	if (this->layers.empty()) {
+		for (const Texture & texture : this->textures) {
+			// Same numbering as Mesh always used: untyped textures have no number
+			std::string name = "uMaterial." + TextureTypeName[texture.type];
+			if (texture.type > TEX_UNKNOWN && texture.type <= TEX_AMBIENT)
+				name += std::to_string(++counts[texture.type]);
+			names.push_back(name);
+
+			uint32_t fields[2] = { texture.handle.value, (uint32_t) texture.type };
+			key = HashBytes(fields, sizeof(fields), key);
+		}
+	} else {
+		for (const TextureLayer & layer : this->layers) {
+			unsigned int number = layer.type <= TEX_AMBIENT ? ++counts[layer.type] : 1;
+			names.push_back("uMaterial." + TextureTypeName[layer.type] + std::to_string(number));
+
+			uint32_t fields[3] = { layer.id, (uint32_t) layer.type, (uint32_t) layer.layer };
+			key = HashBytes(fields, sizeof(fields), key);
+			key = HashBytes(&layer.uvTransform[0], 4 * sizeof(float), key);
+		}
+	}
+}
+
+bool Material :: SameAs(const Material & other) const {
+
+	if (textures.size() != other.textures.size() || layers.size() != other.layers.size())
+		return false;
+	for (size_t i=0; i<textures.size(); i++)
+		if (textures[i].handle != other.textures[i].handle || textures[i].type != other.textures[i].type)
+			return false;
+	for (size_t i=0; i<layers.size(); i++)
+		if (layers[i].id != other.layers[i].id || layers[i].type != other.layers[i].type ||
+			layers[i].layer != other.layers[i].layer || layers[i].uvTransform != other.layers[i].uvTransform)
+			return false;
+	return true;
+}
+
+const Material::Binding & Material :: binding(Shader & shader) {
+
+	ProgramHandle program = shader.Handle();
+	for (const Binding & existing : bindings)
+		if (existing.program == program) return existing;
+
+	Binding binding;
+	binding.program = program;
+	for (const std::string & name : names) {
+		if (layers.empty()) {
+			binding.samplers.push_back(shader.uniformHandle(name));
+		} else {
+			binding.samplers.push_back(shader.uniformHandle(name + ".map"));
+			binding.layerUniforms.push_back(shader.uniformHandle(name + ".layer"));
+			binding.uvTransformUniforms.push_back(shader.uniformHandle(name + ".uvTransform"));
+		}
+	}
+
+	binding.draw.vertexFormat   = shader.uniformHandle("uVertex.format");
+	binding.draw.positionScale  = shader.uniformHandle("uVertex.positionScale");
+	binding.draw.positionOffset = shader.uniformHandle("uVertex.positionOffset");
+	binding.draw.texCoordScale  = shader.uniformHandle("uVertex.texCoordScale");
+	binding.draw.texCoordOffset = shader.uniformHandle("uVertex.texCoordOffset");
+	binding.draw.instanceCount  = shader.uniformHandle("uInstanceCount");
+	binding.draw.instances      = shader.uniformHandle("uInstances");
+
+	bindings.push_back(std::move(binding));
+	return bindings.back();
+}
+
+unsigned int Material :: Bind(Shader & shader) {
+
+	const Binding & binding = this->binding(shader);
+
+	// Skipped by the shadow state when the program has these units already
+	for (unsigned int i=0; i<binding.samplers.size(); i++)
+		shader.setUniform(binding.samplers[i], (int) i);
+
+	unsigned int binds = 0;
+	if (layers.empty()) {
+		// An evicted texture streams back in, see BindTexture
+		for (unsigned int i=0; i<textures.size(); i++) {
+			BindTexture(i, textures[i].handle);
+			binds++;
+		}
+	} else {
+		// Meshes packed together find their arrays bound already
+		for (unsigned int i=0; i<layers.size(); i++) {
+			shader.setUniform(binding.layerUniforms[i], (float) layers[i].layer);
+			shader.setUniform(binding.uvTransformUniforms[i], layers[i].uvTransform);
+			if (BindTextureArray(i, layers[i].id)) binds++;
+		}
+	}
+	glActiveTexture(GL_TEXTURE0);
+
+	return binds;
+}
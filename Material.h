@@ -0,0 +1,75 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include <Handle.h>
+#include <ShaderProgram.h>
+#include <Texture.h>
+#include <TexturePacker.h>
+
+/**
+* Textures of a mesh and the samplers they feed in each shader program.
+*
+* Texture i goes to unit i and to uMaterial.<type name><n>, n counting the
+* textures of its type from 1 (packed layers fill the MatTexLayer_t fields of
+* that sampler instead, see TexturePacker.h). Uniform names are built once;
+* the uniform handles of a (material, program) pair are resolved on its first
+* Bind, later binds are a loop of texture binds without strings or map lookups.
+* Sampler units go through the Shader's shadow state, so they only reach GL
+* when the program's current assignment differs.
+*/
+
+/** Per-draw uniforms of shaders/demo.vert, -1 where the program has no such uniform */
+struct DrawUniforms {
+	UniformHandle vertexFormat;   // uVertex.format
+	UniformHandle positionScale;  // uVertex.positionScale
+	UniformHandle positionOffset; // uVertex.positionOffset
+	UniformHandle texCoordScale;  // uVertex.texCoordScale
+	UniformHandle texCoordOffset; // uVertex.texCoordOffset
+	UniformHandle instanceCount;  // uInstanceCount
+	UniformHandle instances;      // uInstances
+};
+
+class Material {
+public:
+	Material();
+	// layers: packed textures, bound instead of textures when not empty
+	explicit Material(std::vector<Texture> textures,
+		std::vector<TextureLayer> layers = std::vector<TextureLayer>());
+
+	// GL thread, shader in use. Returns the number of texture binds issued
+	unsigned int Bind(Shader & shader);
+	// Resolved along with the samplers, for the draws that follow Bind
+	const DrawUniforms & Uniforms(Shader & shader) { return binding(shader).draw; }
+
+	const std::vector<Texture> & Textures() const { return textures; }
+	const std::vector<TextureLayer> & Layers() const { return layers; }
+	// Equal keys: likely the same textures, confirm with SameAs before sharing
+	uint64_t Key() const { return key; }
+	bool SameAs(const Material & other) const;
+
+private:
+	/** Uniforms of one program, -1 where the program has no such uniform */
+	struct Binding {
+		ProgramHandle program;
+		std::vector<UniformHandle> samplers; // one per texture or layer
+		std::vector<UniformHandle> layerUniforms;
+		std::vector<UniformHandle> uvTransformUniforms;
+		DrawUniforms draw;
+	};
+
+	std::vector<Texture> textures;
+	std::vector<TextureLayer> layers;
+	std::vector<std::string> names; // sampler names, in texture order
+	std::vector<Binding> bindings;  // one per program drawn with, searched linearly
+	uint64_t key;
+
+	const Binding & binding(Shader & shader);
+};
+
+#endif
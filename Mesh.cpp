@@ -1,96 +1,204 @@
 #include <Mesh.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <GeometryArena.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
+static DrawStats drawStats = { 0, 0, 0, 0, 0 };
+
+DrawStats GetDrawStats() {
+	return drawStats;
+}
+
+void ResetDrawStats() {
+	drawStats.drawCalls = 0;
+	drawStats.triangles = 0;
+	drawStats.vaoBinds = 0;
+	drawStats.textureBinds = 0;
+	drawStats.instances = 0;
+}
+
 Mesh :: Mesh(
 	std::vector<Vertex> vertices,
 	std::vector<GLuint> indices,
-	std::vector<Texture> textures) :
-vertices(vertices), indices(indices), textures(textures) {
-	
-	setup();
+	std::vector<Texture> textures,
+	VertexFormat format,
+	std::vector<MeshLod> lods) :
+vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)),
+format(format), lods(std::move(lods)) {
+
+	if (this->lods.empty()) {
+		MeshLod lod = { 0, (unsigned int) this->indices.size(), 0.0f };
+		this->lods.push_back(lod);
+	}
+
+	bounds.min = bounds.max = glm::vec3(0.0f);
+	if (!this->vertices.empty()) bounds.min = bounds.max = this->vertices[0].position;
+	for (const Vertex & vertex : this->vertices) {
+		bounds.min = glm::min(bounds.min, vertex.position);
+		bounds.max = glm::max(bounds.max, vertex.position);
+	}
+
+	// Compact formats upload an encoded copy, the float one uploads vertices as is
+	std::vector<unsigned char> encoded;
+	const void * vertexData = this->vertices.data();
+	dequant = IdentityDequant();
+	if (format != VERTEX_FLOAT) {
+		dequant = EncodeVertices(this->vertices.data(), this->vertices.size(), format, encoded);
+		vertexData = encoded.data();
+	}
+
+	// Meshes addressing fewer than 64k vertices draw with 16-bit indices
+	if (IndexTypeFor(this->vertices.size()) == GL_UNSIGNED_SHORT) {
+		std::vector<GLushort> shortIndices(this->indices.begin(), this->indices.end());
+		setup(vertexData, this->vertices.size(),
+			shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT);
+	} else {
+		setup(vertexData, this->vertices.size(),
+			this->indices.data(), this->indices.size(), GL_UNSIGNED_INT);
+	}
 }
 
-void Mesh :: setup() {
-
-	glGenBuffers(1, &vbo); // Generate an empty vertex buffer on the GPU
-	glGenBuffers(1, &ebo);
-	glGenVertexArrays(1, &vao); // Tell OpenGL to create new Vertex Array Object
-	
-	glBindVertexArray(vao); // Make the vertices buffer the current one
-	
-	glBindBuffer(GL_ARRAY_BUFFER, vbo); // "bind" or set as the current buffer we are working with
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-	glEnableVertexAttribArray(0); // vertex positions
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
-	glEnableVertexAttribArray(1); // vertex normals
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-	glEnableVertexAttribArray(2); // vertex texture coords
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-	glEnableVertexAttribArray(3); // vertex tangent coords
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-	glEnableVertexAttribArray(4); // vertex bitangent coords
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-
-	glBindVertexArray(0); // Release control of vao
+Mesh :: Mesh(
+	const void * vertexData, size_t numVertices,
+	VertexFormat format, const VertexDequant & dequant,
+	const void * indexData, size_t numIndices, GLenum indexType,
+	std::vector<MeshLod> lods, const MeshBounds & bounds,
+	std::vector<Texture> textures, bool collision) :
+textures(std::move(textures)), format(format), dequant(dequant), lods(std::move(lods)), bounds(bounds) {
+
+	setup(vertexData, numVertices, indexData, numIndices, indexType);
+
+	if (!collision) return;
+	const MeshLod & lod = this->lods[0];
+	this->collision.positions.resize(numVertices);
+	DecodePositions(vertexData, numVertices, format, dequant, this->collision.positions.data());
+	this->collision.indices.resize(lod.count);
+	for (unsigned int i=0; i<lod.count; i++) {
+		this->collision.indices[i] = indexType == GL_UNSIGNED_SHORT
+			? ((const GLushort *) indexData)[lod.first + i]
+			: ((const GLuint *) indexData)[lod.first + i];
+	}
 }
 
-void Mesh :: Draw(Shader & shader) {
+void Mesh :: BuildCollision() {
 
-	// Bind textures
-	unsigned int diffuseNr  = 1;
-	unsigned int specularNr = 1;
-	unsigned int normalNr   = 1;
-	unsigned int heightNr   = 1;
-	unsigned int emissionNr = 1;
-	unsigned int ambientNr  = 1;
-
-	for (unsigned int i=0; i<textures.size(); i++) {
-
-		glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-
-		std::string number;
-		TextureType type = textures[i].type;
-
-		if (type == TEX_DIFFUSE)
-			number = std::to_string(diffuseNr++);
-		else if (type == TEX_SPECULAR)
-			number = std::to_string(specularNr++);
-		else if (type == TEX_NORMAL)
-			number = std::to_string(normalNr++);
-		else if (type == TEX_HEIGHT)
-			number = std::to_string(heightNr++);
-		else if (type == TEX_EMISSION)
-			number = std::to_string(emissionNr++);
-		else if (type == TEX_AMBIENT)
-			number = std::to_string(ambientNr++);
-
-		shader.setUniform("uMaterial." + TextureTypeName[type] + number, (int)i);
-		// Bind the texture
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	if (vertices.empty()) return;
+
+	collision.positions.resize(vertices.size());
+	for (size_t i=0; i<vertices.size(); i++)
+		collision.positions[i] = vertices[i].position;
+	collision.indices.assign(indices.begin() + lods[0].first, indices.begin() + lods[0].first + lods[0].count);
+}
+
+void Mesh :: ReleaseCpuData() {
+
+	// Swapping with empty vectors returns their storage, clear() would keep it
+	std::vector<Vertex>().swap(vertices);
+	std::vector<unsigned int>().swap(indices);
+}
+
+size_t Mesh :: CpuBytes() const {
+	return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int)
+		+ collision.positions.capacity() * sizeof(glm::vec3)
+		+ collision.indices.capacity() * sizeof(unsigned int);
+}
+
+GLenum Mesh :: IndexTypeFor(size_t numVertices) {
+	return numVertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t Mesh :: IndexSize(GLenum indexType) {
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+void Mesh :: setup(
+	const void * vertexData, size_t numVertices,
+	const void * indexData, size_t numIndices, GLenum indexType) {
+
+	this->indexType = indexType;
+	this->numVertices = numVertices;
+
+	allocation = ArenaHandle(ArenaAllocate(format, vertexData, numVertices,
+		indexData, numIndices * IndexSize(indexType)));
+	buildRecords();
+}
+
+void Mesh :: buildRecords() {
+
+	records.resize(lods.size());
+	for (size_t i=0; i<lods.size(); i++) {
+		DrawRecord & record = records[i];
+		record.geometry   = allocation.Id();
+		record.firstIndex = lods[i].first;
+		record.count      = lods[i].count;
+		record.indexType  = (uint16_t) indexType;
+		record.format     = (uint8_t) format;
+		record.material   = material.get();
+		record.dequant    = dequant;
 	}
-	glActiveTexture(GL_TEXTURE0);
+}
+
+const DrawRecord & Mesh :: Record(unsigned int lod) const {
+	return records[std::min(lod, (unsigned int) records.size() - 1)];
+}
+
+void Mesh :: SetMaterial(std::shared_ptr<Material> material) {
+	this->material = std::move(material);
+	buildRecords();
+}
+
+void Mesh :: Draw(Shader & shader, unsigned int lod) {
+
+	if (!material) SetMaterial(std::make_shared<Material>(textures, layers));
+	const DrawRecord & record = Record(lod);
+
+	// Bind textures
+	drawStats.textureBinds += record.material->Bind(shader);
+	const DrawUniforms & uniforms = record.material->Uniforms(shader);
+
+	// Dequantization of compact vertex formats
+	shader.setUniform(uniforms.vertexFormat, (int) record.format);
+	shader.setUniform(uniforms.positionScale, record.dequant.positionScale);
+	shader.setUniform(uniforms.positionOffset, record.dequant.positionOffset);
+	shader.setUniform(uniforms.texCoordScale, record.dequant.texCoordScale);
+	shader.setUniform(uniforms.texCoordOffset, record.dequant.texCoordOffset);
 
 	// Draw mesh
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	ArenaRange arena = ArenaGetRange(record.geometry);
+	void * first = (void*)(arena.indexOffset + record.firstIndex * IndexSize(record.indexType));
+	if (ArenaBind(record.geometry)) drawStats.vaoBinds++;
+
+	if (instances.empty()) {
+		shader.setUniform(uniforms.instanceCount, 0);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei) record.count, record.indexType, first, arena.baseVertex);
+		drawStats.drawCalls++;
+		drawStats.triangles += record.count / 3;
+		drawStats.instances++;
+	}
+
+	// Shared mesh: one draw per MAX_INSTANCES placements
+	for (size_t i=0; i<instances.size(); i+=MAX_INSTANCES) {
+		GLsizei count = (GLsizei) std::min(instances.size() - i, (size_t) MAX_INSTANCES);
+		shader.setUniform(uniforms.instances, &instances[i], count);
+		shader.setUniform(uniforms.instanceCount, (int) count);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei) record.count, record.indexType, first,
+			count, arena.baseVertex);
+		drawStats.drawCalls++;
+		drawStats.triangles += record.count / 3 * count;
+		drawStats.instances += count;
+	}
 
 	glActiveTexture(GL_TEXTURE0);
 }
 
 void Mesh :: DeleteBuffers() {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &vbo);
-	glDeleteBuffers(1, &ebo);
+	allocation.Reset();
+	buildRecords();
 }
@@ -3,12 +3,18 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <memory>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <TexturePacker.h>
+#include <VertexFormat.h>
+#include <GeometryArena.h>
+#include <Material.h>
 
 struct Pixel {
 	glm::vec2 position;
@@ -23,33 +29,143 @@ struct Vertex {
 	glm::vec3 bitangent;
 };
 
+/** Index range of one level of detail inside the element buffer */
+struct MeshLod {
+	unsigned int first; // first index
+	unsigned int count;
+	float error;        // simplification error in model space units
+};
+
+struct MeshBounds {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+/** Positions-only copy of the full detail level, kept for picking by GPU-only meshes */
+struct MeshCollision {
+	std::vector<glm::vec3> positions;  // model space
+	std::vector<unsigned int> indices; // triangles of LOD 0
+};
+
+/**
+* One draw of a mesh level as handles and small integers, built when the mesh
+* is uploaded and when its material changes: Draw reads one 64-byte cache line
+* per submission, the Mesh itself (vectors, CPU copies) stays out of it.
+* Handles resolve to GL names at bind time.
+*/
+struct DrawRecord {
+	GeometryHandle geometry;
+	uint32_t firstIndex;
+	uint32_t count;
+	uint16_t indexType;  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint8_t  format;     // VertexFormat
+	Material * material; // not owned: shared by meshes with equal textures, see Model::shareMaterials
+	VertexDequant dequant;
+};
+
+static_assert(sizeof(DrawRecord) <= 64, "DrawRecord must fit a cache line");
+
+/** Draw submission counters, reset by the application once per frame */
+struct DrawStats {
+	size_t drawCalls;
+	size_t triangles;
+	size_t vaoBinds;
+	size_t textureBinds;
+	size_t instances; // placements drawn, one per plain draw
+};
+
+DrawStats GetDrawStats();
+void ResetDrawStats();
+
 class Mesh {
 
 public:
-	/** Mesh Data */
+	static const unsigned int MAX_LODS = 4;
+	static const unsigned int MAX_INSTANCES = 32; // placements per instanced draw, see shaders/demo.vert
+
+	/** Mesh Data, vertices and indices are empty once uploaded from a cache or released */
 	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
+	std::vector<unsigned int> indices; // all levels of detail, back to back
+	// The first Draw makes a Material of textures and layers unless one is set,
+	// later changes need SetMaterial
 	std::vector<Texture> textures;
+	std::vector<TextureLayer> layers; // packed textures; when set, drawn instead of textures
+	// World transforms of every placement (see Model::Nodes), drawn with
+	// glDrawElementsInstanced as uModel * uInstances[gl_InstanceID]; empty
+	// draws once at uModel
+	std::vector<glm::mat4> instances;
 
 	/** Methods */
+	// lods index into indices; empty means a single level covering all of them
 	Mesh(std::vector<Vertex> vertices,
 		std::vector<unsigned int> indices,
-		std::vector<Texture> textures);
+		std::vector<Texture> textures,
+		VertexFormat format = VERTEX_FLOAT,
+		std::vector<MeshLod> lods = std::vector<MeshLod>());
+	// Upload straight from external storage (e.g. a mapped MeshCache),
+	// the vertices and indices vectors are left empty. vertexData is already
+	// encoded in format, indexData holds numIndices elements of indexType
+	// (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+	Mesh(const void * vertexData, size_t numVertices,
+		VertexFormat format, const VertexDequant & dequant,
+		const void * indexData, size_t numIndices, GLenum indexType,
+		std::vector<MeshLod> lods, const MeshBounds & bounds,
+		std::vector<Texture> textures, bool collision = false);
 	//~Mesh();
 
-	void Draw(Shader & shader);
+	// Positions-only copy of vertices and the LOD 0 indices, see Collision()
+	void BuildCollision();
+	// GPU-only residency: frees the vertices and indices vectors once they are
+	// uploaded, counts, bounds and LOD ranges stay
+	void ReleaseCpuData();
+	// Bytes held on the CPU by vertices, indices and the collision copy
+	size_t CpuBytes() const;
+	const MeshCollision & Collision() const { return collision; }
+
+	// Leaves the arena VAO bound for the next mesh, finish with ArenaUnbind()
+	void Draw(Shader & shader, unsigned int lod = 0);
+	const DrawRecord & Record(unsigned int lod = 0) const;
+	// Meshes with the same textures can share one (see Model), null rebuilds on the next Draw
+	void SetMaterial(std::shared_ptr<Material> material);
+	const std::shared_ptr<Material> & GetMaterial() const { return material; }
 	void DeleteBuffers();
 
-	GLuint VAO() const { return vao; }
-	GLuint VBO() const { return vbo; }
-	GLuint EBO() const { return ebo; }
+	/** Storage in the GeometryArena, shared with other meshes of the same format */
+	GLuint VAO() const { return ArenaGetRange(allocation.Id()).vao; }
+	GLuint VBO() const { return ArenaGetRange(allocation.Id()).vbo; }
+	GLuint EBO() const { return ArenaGetRange(allocation.Id()).ebo; }
+	GLint BaseVertex() const { return ArenaGetRange(allocation.Id()).baseVertex; }
+	size_t IndexOffset() const { return ArenaGetRange(allocation.Id()).indexOffset; } // bytes, LOD ranges add to it
+	GLsizei NumIndices() const { return (GLsizei) lods[0].count; } // full detail
+	GLenum IndexType() const { return indexType; }
+	size_t NumVertices() const { return numVertices; }
+	VertexFormat Format() const { return format; }
+	const VertexDequant & Dequant() const { return dequant; }
+	unsigned int NumLods() const { return (unsigned int) lods.size(); }
+	const MeshLod & Lod(unsigned int i) const { return lods[i]; }
+	const MeshBounds & Bounds() const { return bounds; }
+
+	/** Smallest index type able to address numVertices vertices */
+	static GLenum IndexTypeFor(size_t numVertices);
+	static size_t IndexSize(GLenum indexType);
 
 private:
 	/** Render Data */
-	GLuint vbo, ebo, vao;
+	ArenaHandle allocation; // freed with the mesh, which makes Mesh move-only
+	GLenum indexType;
+	size_t numVertices;
+	VertexFormat format;
+	VertexDequant dequant;
+	std::vector<MeshLod> lods;
+	MeshBounds bounds;
+	MeshCollision collision;
+	std::shared_ptr<Material> material; // shared with other meshes of the model, see Model::shareMaterials
+	std::vector<DrawRecord> records; // one per LOD
 
 	/** Methods */
-	void setup();
+	void setup(const void * vertexData, size_t numVertices,
+		const void * indexData, size_t numIndices, GLenum indexType);
+	void buildRecords();
 };
 
 #endif
\ No newline at end of file
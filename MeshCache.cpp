@@ -0,0 +1,578 @@
+#include <MeshCache.h>
+#include <Hash.h>
+#include <Mesh.h>
+#include <Texture.h>
+#include <VertexFormat.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+
+const uint32_t MeshCache :: VERSION   = 8;
+const size_t   MeshCache :: PAGE_SIZE = 4096;
+
+static const char MESH_CACHE_MAGIC[8] = { 'L', 'O', 'G', 'L', 'M', 'E', 'S', 'H' };
+
+struct MeshCacheHeader {
+	char     magic[8];
+	uint32_t version;
+	uint32_t vertexSize;
+	uint32_t numMeshes;
+	uint32_t numNodes;
+	uint32_t flags;      // import flags the meshes were processed with
+	uint64_t sourceSize;
+	int64_t  sourceMtime;
+	uint64_t sourceHash;
+	uint64_t materialSize; // MaterialLibraryKey of the source
+	int64_t  materialMtime;
+	uint64_t materialHash;
+};
+
+struct MeshCacheRecord {
+	uint64_t numVertices;
+	uint64_t vertexOffset;
+	uint64_t numIndices;
+	uint64_t indexOffset;
+	uint64_t textureOffset;
+	uint64_t placementOffset;
+	uint32_t numTextures;
+	uint32_t numPlacements;
+	uint32_t indexSize;  // 2 or 4 bytes
+	uint32_t vertexFormat;
+	float    dequant[10]; // position scale, offset, texCoord scale, offset
+	uint32_t numLods;
+	uint32_t lodFirst[Mesh::MAX_LODS];
+	uint32_t lodCount[Mesh::MAX_LODS];
+	float    lodError[Mesh::MAX_LODS];
+	float    bounds[6];   // min, max
+};
+
+struct MeshCacheNode {
+	int32_t  parent;     // -1 for a root
+	uint32_t nameLength;
+	uint64_t nameOffset;
+	float    local[16];  // column major
+};
+
+static const MeshCacheNode * CacheNodes(const unsigned char * data, unsigned int numMeshes) {
+	return (const MeshCacheNode *) (data + sizeof(MeshCacheHeader) + numMeshes * sizeof(MeshCacheRecord));
+}
+
+static std::string CachePath(const std::string & sourcePath) {
+	return sourcePath + ".meshcache";
+}
+
+static size_t AlignUp(size_t offset, size_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+/*************************************************
+* File mapping
+*************************************************/
+
+static bool MapFile(const std::string & path, const unsigned char *& data, size_t & size,
+	std::vector<unsigned char> & buffer) {
+
+	data = NULL;
+	size = 0;
+
+#ifndef _WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	void * ptr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps its own reference
+	if (ptr == MAP_FAILED) return false;
+
+	data = (const unsigned char *) ptr;
+	size = (size_t) st.st_size;
+	(void) buffer;
+	return true;
+#else
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+
+	std::streamsize length = file.tellg();
+	if (length <= 0) return false;
+	file.seekg(0, std::ios::beg);
+
+	buffer.resize((size_t) length);
+	if (!file.read((char *) buffer.data(), length)) {
+		buffer.clear();
+		return false;
+	}
+
+	data = buffer.data();
+	size = buffer.size();
+	return true;
+#endif
+}
+
+static void UnmapFile(const unsigned char * data, size_t size, std::vector<unsigned char> & buffer) {
+#ifndef _WIN32
+	if (data) munmap((void *) data, size);
+#endif
+	buffer.clear();
+	buffer.shrink_to_fit();
+}
+
+/*************************************************
+* Source key
+*************************************************/
+
+bool SourceFileKey(const std::string & path, uint64_t & size, int64_t & mtime, uint64_t & hash) {
+
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) return false;
+
+	const unsigned char * data;
+	size_t length;
+	std::vector<unsigned char> buffer;
+	if (!MapFile(path, data, length, buffer)) return false;
+
+	size  = (uint64_t) st.st_size;
+	mtime = (int64_t) st.st_mtime;
+	hash  = HashBytes(data, length);
+
+	UnmapFile(data, length, buffer);
+	return true;
+}
+
+static bool IsObjFile(const std::string & path) {
+	std::string ext = path.substr(path.find_last_of('.') + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == "obj";
+}
+
+bool MaterialLibraryKey(const std::string & path, uint64_t & size, int64_t & mtime, uint64_t & hash) {
+
+	size = 0;
+	mtime = 0;
+	hash = 0;
+	if (!IsObjFile(path)) return true;
+	hash = HashBytes(NULL, 0); // the seed, each library chains onto it
+
+	std::ifstream file(path);
+	if (!file.is_open()) return false;
+
+	// "mtllib <name>", the rest of the line relative to the OBJ, as ASSIMP reads it
+	std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.compare(0, 6, "mtllib") != 0 || line.size() < 7 || !std::isspace((unsigned char) line[6]))
+			continue;
+		size_t first = line.find_first_not_of(" \t", 6), last = line.find_last_not_of(" \t\r");
+		if (first == std::string::npos || last < first) continue;
+		std::string library = directory + line.substr(first, last - first + 1);
+
+		// A missing library still counts, so the cache goes stale once it appears
+		uint64_t libSize = 0, libHash = 0;
+		int64_t libMtime = 0;
+		if (!SourceFileKey(library, libSize, libMtime, libHash))
+			libHash = HashBytes(library.data(), library.size());
+
+		size += libSize;
+		mtime = std::max(mtime, libMtime);
+		hash = HashBytes(&libHash, sizeof(libHash), hash);
+	}
+	return true;
+}
+
+/*************************************************
+* MeshCache
+*************************************************/
+
+MeshCache :: MeshCache()
+	: data(NULL), size(0), numMeshes(0), numNodes(0)
+{}
+
+MeshCache :: ~MeshCache() {
+	Close();
+}
+
+void MeshCache :: Close() {
+	UnmapFile(data, size, buffer);
+	data = NULL;
+	size = 0;
+	numMeshes = 0;
+	numNodes = 0;
+}
+
+bool MeshCache :: Open(const std::string & sourcePath, uint32_t flags) {
+
+	Close();
+
+	if (!MapFile(CachePath(sourcePath), data, size, buffer))
+		return false;
+
+	MeshCacheHeader header;
+	if (size < sizeof(header)) {
+		Close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != VERSION ||
+		header.vertexSize != sizeof(Vertex) ||
+		header.flags != flags ||
+		size < sizeof(header) + header.numMeshes * sizeof(MeshCacheRecord) + header.numNodes * sizeof(MeshCacheNode)) {
+		Close();
+		return false;
+	}
+
+	// Stale check: size, mtime and content of the source file and its material
+	// libraries must all match
+	uint64_t srcSize, srcHash, mtlSize, mtlHash;
+	int64_t srcMtime, mtlMtime;
+	if (!SourceFileKey(sourcePath, srcSize, srcMtime, srcHash) ||
+		srcSize != header.sourceSize ||
+		srcMtime != header.sourceMtime ||
+		srcHash != header.sourceHash ||
+		!MaterialLibraryKey(sourcePath, mtlSize, mtlMtime, mtlHash) ||
+		mtlSize != header.materialSize ||
+		mtlMtime != header.materialMtime ||
+		mtlHash != header.materialHash) {
+		Close();
+		return false;
+	}
+
+	// Bounds check every record once so the accessors can stay unchecked
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(header));
+	for (unsigned int i=0; i<header.numMeshes; i++) {
+		const MeshCacheRecord & r = records[i];
+		if ((r.indexSize != sizeof(GLushort) && r.indexSize != sizeof(GLuint)) ||
+			r.vertexFormat >= NUM_VERTEX_FORMATS ||
+			r.vertexOffset + r.numVertices * VertexSize((VertexFormat) r.vertexFormat) > size ||
+			r.indexOffset + r.numIndices * r.indexSize > size ||
+			r.textureOffset > size ||
+			r.placementOffset + r.numPlacements * sizeof(uint32_t) > size ||
+			r.numLods == 0 || r.numLods > Mesh::MAX_LODS) {
+			Close();
+			return false;
+		}
+		for (unsigned int l=0; l<r.numLods; l++) {
+			if ((uint64_t) r.lodFirst[l] + r.lodCount[l] > r.numIndices) {
+				Close();
+				return false;
+			}
+		}
+		for (unsigned int p=0; p<r.numPlacements; p++) {
+			uint32_t node;
+			std::memcpy(&node, data + r.placementOffset + p * sizeof(node), sizeof(node));
+			if (node >= header.numNodes) {
+				Close();
+				return false;
+			}
+		}
+	}
+
+	// Parents before children, names inside the file
+	const MeshCacheNode * nodes = CacheNodes(data, header.numMeshes);
+	for (unsigned int n=0; n<header.numNodes; n++) {
+		if (nodes[n].parent < -1 || nodes[n].parent >= (int32_t) n ||
+			nodes[n].nameOffset + nodes[n].nameLength > size) {
+			Close();
+			return false;
+		}
+	}
+
+	numMeshes = header.numMeshes;
+	numNodes = header.numNodes;
+	return true;
+}
+
+size_t MeshCache :: NumVertices(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return (size_t) records[i].numVertices;
+}
+
+size_t MeshCache :: NumIndices(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return (size_t) records[i].numIndices;
+}
+
+const void * MeshCache :: Vertices(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return data + records[i].vertexOffset;
+}
+
+VertexFormat MeshCache :: Format(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return (VertexFormat) records[i].vertexFormat;
+}
+
+VertexDequant MeshCache :: Dequant(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	const float * d = records[i].dequant;
+	VertexDequant dequant;
+	dequant.positionScale  = glm::vec3(d[0], d[1], d[2]);
+	dequant.positionOffset = glm::vec3(d[3], d[4], d[5]);
+	dequant.texCoordScale  = glm::vec2(d[6], d[7]);
+	dequant.texCoordOffset = glm::vec2(d[8], d[9]);
+	return dequant;
+}
+
+const void * MeshCache :: Indices(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return data + records[i].indexOffset;
+}
+
+GLenum MeshCache :: IndexType(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	return records[i].indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+std::vector<MeshLod> MeshCache :: Lods(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	std::vector<MeshLod> lods(records[i].numLods);
+	for (unsigned int l=0; l<records[i].numLods; l++) {
+		lods[l].first = records[i].lodFirst[l];
+		lods[l].count = records[i].lodCount[l];
+		lods[l].error = records[i].lodError[l];
+	}
+	return lods;
+}
+
+MeshBounds MeshCache :: Bounds(unsigned int i) const {
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	const float * b = records[i].bounds;
+	MeshBounds bounds;
+	bounds.min = glm::vec3(b[0], b[1], b[2]);
+	bounds.max = glm::vec3(b[3], b[4], b[5]);
+	return bounds;
+}
+
+std::vector<MeshCacheTexture> MeshCache :: Textures(unsigned int i) const {
+
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	std::vector<MeshCacheTexture> textures;
+
+	size_t offset = (size_t) records[i].textureOffset;
+	for (unsigned int t=0; t<records[i].numTextures; t++) {
+
+		uint32_t fields[3]; // type, isDefault, length
+		if (offset + sizeof(fields) > size) break;
+		std::memcpy(fields, data + offset, sizeof(fields));
+		offset += sizeof(fields);
+		if (offset + fields[2] > size) break;
+
+		MeshCacheTexture texture;
+		texture.type = (TextureType) fields[0];
+		texture.isDefault = fields[1] != 0;
+		texture.path.assign((const char *) data + offset, fields[2]);
+		offset += fields[2];
+
+		textures.push_back(texture);
+	}
+
+	return textures;
+}
+
+std::vector<unsigned int> MeshCache :: Placements(unsigned int i) const {
+
+	const MeshCacheRecord * records = (const MeshCacheRecord *) (data + sizeof(MeshCacheHeader));
+	std::vector<unsigned int> placements(records[i].numPlacements);
+	for (size_t p=0; p<placements.size(); p++) {
+		uint32_t node;
+		std::memcpy(&node, data + records[i].placementOffset + p * sizeof(node), sizeof(node));
+		placements[p] = node;
+	}
+	return placements;
+}
+
+int MeshCache :: NodeParent(unsigned int n) const {
+	return CacheNodes(data, numMeshes)[n].parent;
+}
+
+glm::mat4 MeshCache :: NodeLocal(unsigned int n) const {
+	glm::mat4 local;
+	std::memcpy(&local[0][0], CacheNodes(data, numMeshes)[n].local, sizeof(float) * 16);
+	return local;
+}
+
+std::string MeshCache :: NodeName(unsigned int n) const {
+	const MeshCacheNode & node = CacheNodes(data, numMeshes)[n];
+	return std::string((const char *) data + node.nameOffset, node.nameLength);
+}
+
+bool MeshCache :: Write(const std::string & sourcePath, const std::vector<Mesh> & meshes,
+	const SceneGraph & nodes, const std::vector<std::vector<unsigned int> > & placements,
+	uint32_t flags) {
+
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.numMeshes = (uint32_t) meshes.size();
+	header.numNodes = (uint32_t) nodes.Size();
+	header.flags = flags;
+	if (!SourceFileKey(sourcePath, header.sourceSize, header.sourceMtime, header.sourceHash) ||
+		!MaterialLibraryKey(sourcePath, header.materialSize, header.materialMtime, header.materialHash))
+		return false;
+
+	// Serialize nodes, texture bindings and placements first, then lay out the page-aligned arrays after them
+	std::vector<MeshCacheRecord> records(meshes.size());
+	std::vector<MeshCacheNode> nodeRecords(nodes.Size());
+	std::vector<char> names;
+	std::vector<char> bindings;
+	std::vector<uint32_t> nodeIndices;
+	size_t offset = sizeof(header) + records.size() * sizeof(MeshCacheRecord)
+		+ nodeRecords.size() * sizeof(MeshCacheNode);
+
+	for (unsigned int n=0; n<nodes.Size(); n++) {
+		const std::string & name = nodes.Name(n);
+		nodeRecords[n].parent = nodes.Parent(n);
+		nodeRecords[n].nameLength = (uint32_t) name.size();
+		nodeRecords[n].nameOffset = offset + names.size();
+		std::memcpy(nodeRecords[n].local, &nodes.Local(n)[0][0], sizeof(nodeRecords[n].local));
+		names.insert(names.end(), name.begin(), name.end());
+	}
+	offset += names.size();
+
+	for (size_t i=0; i<meshes.size(); i++) {
+		const Mesh & mesh = meshes[i];
+		records[i].textureOffset = offset + bindings.size();
+		records[i].numTextures = (uint32_t) mesh.textures.size();
+		records[i].indexSize = (uint32_t) Mesh::IndexSize(mesh.IndexType());
+		records[i].vertexFormat = (uint32_t) mesh.Format();
+
+		records[i].numLods = mesh.NumLods();
+		for (unsigned int l=0; l<Mesh::MAX_LODS; l++) {
+			bool used = l < mesh.NumLods();
+			records[i].lodFirst[l] = used ? mesh.Lod(l).first : 0;
+			records[i].lodCount[l] = used ? mesh.Lod(l).count : 0;
+			records[i].lodError[l] = used ? mesh.Lod(l).error : 0.0f;
+		}
+
+		const MeshBounds & bounds = mesh.Bounds();
+		const float b[6] = {
+			bounds.min.x, bounds.min.y, bounds.min.z,
+			bounds.max.x, bounds.max.y, bounds.max.z
+		};
+		std::memcpy(records[i].bounds, b, sizeof(b));
+
+		const VertexDequant & dequant = mesh.Dequant();
+		const float d[10] = {
+			dequant.positionScale.x, dequant.positionScale.y, dequant.positionScale.z,
+			dequant.positionOffset.x, dequant.positionOffset.y, dequant.positionOffset.z,
+			dequant.texCoordScale.x, dequant.texCoordScale.y,
+			dequant.texCoordOffset.x, dequant.texCoordOffset.y
+		};
+		std::memcpy(records[i].dequant, d, sizeof(d));
+
+		for (const Texture & texture : mesh.textures) {
+			const std::string & path = InternedString(texture.path);
+			uint32_t fields[3] = {
+				(uint32_t) texture.type,
+				IsDefaultTexture(texture) ? 1u : 0u,
+				(uint32_t) path.size()
+			};
+			bindings.insert(bindings.end(), (const char *) fields, (const char *) fields + sizeof(fields));
+			bindings.insert(bindings.end(), path.begin(), path.end());
+		}
+	}
+	offset += bindings.size();
+
+	for (size_t i=0; i<meshes.size() && i<placements.size(); i++) {
+		records[i].placementOffset = offset + nodeIndices.size() * sizeof(uint32_t);
+		records[i].numPlacements = (uint32_t) placements[i].size();
+		nodeIndices.insert(nodeIndices.end(), placements[i].begin(), placements[i].end());
+	}
+	offset += nodeIndices.size() * sizeof(uint32_t);
+
+	for (size_t i=0; i<meshes.size(); i++) {
+		const Mesh & mesh = meshes[i];
+		records[i].numVertices = mesh.vertices.size();
+		records[i].vertexOffset = offset = AlignUp(offset, PAGE_SIZE);
+		offset += mesh.vertices.size() * VertexSize(mesh.Format());
+		records[i].numIndices = mesh.indices.size();
+		records[i].indexOffset = offset = AlignUp(offset, PAGE_SIZE);
+		offset += mesh.indices.size() * records[i].indexSize;
+	}
+
+	// Write to a temporary file and rename, so a reader never maps a partial blob
+	std::string cachePath = CachePath(sourcePath);
+	std::string tempPath = cachePath + ".tmp";
+	std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "MeshCache::Write: Unable to open " << tempPath << "\n";
+		return false;
+	}
+
+	const char zeros[PAGE_SIZE] = {};
+	size_t written = 0;
+	auto pad = [&](size_t target) {
+		while (written < target) {
+			size_t n = std::min(target - written, PAGE_SIZE);
+			file.write(zeros, n);
+			written += n;
+		}
+	};
+
+	file.write((const char *) &header, sizeof(header));
+	file.write((const char *) records.data(), records.size() * sizeof(MeshCacheRecord));
+	file.write((const char *) nodeRecords.data(), nodeRecords.size() * sizeof(MeshCacheNode));
+	file.write(names.data(), names.size());
+	file.write(bindings.data(), bindings.size());
+	file.write((const char *) nodeIndices.data(), nodeIndices.size() * sizeof(uint32_t));
+	written = sizeof(header) + records.size() * sizeof(MeshCacheRecord)
+		+ nodeRecords.size() * sizeof(MeshCacheNode) + names.size() + bindings.size()
+		+ nodeIndices.size() * sizeof(uint32_t);
+
+	for (size_t i=0; i<meshes.size(); i++) {
+		const Mesh & mesh = meshes[i];
+		pad((size_t) records[i].vertexOffset);
+		if (mesh.Format() == VERTEX_FLOAT) {
+			file.write((const char *) mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+		} else {
+			// Same encoding Mesh uploaded, so the stored dequantization matches
+			std::vector<unsigned char> encoded;
+			EncodeVertices(mesh.vertices.data(), mesh.vertices.size(), mesh.Format(), encoded);
+			file.write((const char *) encoded.data(), encoded.size());
+		}
+		written += mesh.vertices.size() * VertexSize(mesh.Format());
+		pad((size_t) records[i].indexOffset);
+		if (mesh.IndexType() == GL_UNSIGNED_SHORT) {
+			std::vector<GLushort> shortIndices(mesh.indices.begin(), mesh.indices.end());
+			file.write((const char *) shortIndices.data(), shortIndices.size() * sizeof(GLushort));
+		} else {
+			file.write((const char *) mesh.indices.data(), mesh.indices.size() * sizeof(GLuint));
+		}
+		written += mesh.indices.size() * records[i].indexSize;
+	}
+
+	file.close();
+	if (!file) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::remove(cachePath.c_str());
+	if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,93 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <Hash.h>
+#include <Texture.h>
+#include <Mesh.h>
+#include <VertexFormat.h>
+#include <SceneGraph.h>
+
+/**
+* Binary mesh cache written next to a model file ("<model>.meshcache").
+*
+* Layout (native endianness):
+*   MeshCacheHeader
+*   MeshCacheRecord[numMeshes]
+*   MeshCacheNode[numNodes], node names
+*   texture bindings: { uint32 type, uint32 isDefault, uint32 length, char path[length] } ...
+*   placements: uint32 node per placement of each mesh (see Model::Nodes)
+*   vertex / index arrays, each starting on a page boundary; vertices are stored
+*   in the mesh's VertexFormat, indices are 16-bit for meshes that fit (see
+*   Mesh::IndexTypeFor)
+*
+* The blob is keyed by the source file size, mtime, content hash and the import
+* flags the meshes were processed with, and for OBJ files by the same key of the
+* material libraries it names, whose texture bindings are baked into the blob.
+* A warm load maps the file and hands the arrays straight to glBufferData.
+*/
+
+struct MeshCacheTexture {
+	TextureType type;
+	bool isDefault;
+	std::string path;
+};
+
+class MeshCache {
+public:
+	static const uint32_t VERSION;
+	static const size_t   PAGE_SIZE;
+
+	MeshCache();
+	~MeshCache();
+
+	/** Map the cache of a source file. Returns false if it is missing or stale. */
+	bool Open(const std::string & sourcePath, uint32_t flags = 0);
+	void Close();
+
+	/** Write the cache of a source file from freshly imported meshes, placed by nodes */
+	static bool Write(const std::string & sourcePath, const std::vector<Mesh> & meshes,
+		const SceneGraph & nodes, const std::vector<std::vector<unsigned int> > & placements,
+		uint32_t flags = 0);
+
+	unsigned int NumMeshes() const { return numMeshes; }
+	size_t NumVertices(unsigned int i) const;
+	size_t NumIndices(unsigned int i) const;
+	const void * Vertices(unsigned int i) const;
+	VertexFormat Format(unsigned int i) const;
+	VertexDequant Dequant(unsigned int i) const;
+	std::vector<MeshLod> Lods(unsigned int i) const;
+	MeshBounds Bounds(unsigned int i) const;
+	const void * Indices(unsigned int i) const;
+	GLenum IndexType(unsigned int i) const;
+	std::vector<MeshCacheTexture> Textures(unsigned int i) const;
+	std::vector<unsigned int> Placements(unsigned int i) const;
+
+	/** Node hierarchy, depth first (see SceneGraph::AddNode) */
+	unsigned int NumNodes() const { return numNodes; }
+	int NodeParent(unsigned int n) const;
+	glm::mat4 NodeLocal(unsigned int n) const;
+	std::string NodeName(unsigned int n) const;
+
+private:
+	const unsigned char * data;
+	size_t size;
+	unsigned int numMeshes;
+	unsigned int numNodes;
+	std::vector<unsigned char> buffer; // used where mmap is unavailable
+
+	MeshCache(const MeshCache &);
+	MeshCache & operator=(const MeshCache &);
+};
+
+/** Source file key */
+bool SourceFileKey(const std::string & path, uint64_t & size, int64_t & mtime, uint64_t & hash);
+
+/** Combined key of the mtllib files an OBJ names, zero for other formats */
+bool MaterialLibraryKey(const std::string & path, uint64_t & size, int64_t & mtime, uint64_t & hash);
+
+#endif
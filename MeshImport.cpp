@@ -0,0 +1,182 @@
+#include <MeshImport.h>
+#include <MeshOptimizer.h>
+#include <Model.h>
+
+#include <assimp/mesh.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MESHIMPORT_SSE
+#include <xmmintrin.h>
+#endif
+
+/*************************************************
+* Vertices
+*************************************************/
+
+// Four floats each, so the SIMD loads may read a lane past the vector
+static const float DEFAULT_POSITION[4]  = { 0.0f, 0.0f, 0.0f, 0.0f };
+static const float DEFAULT_NORMAL[4]    = { 0.0f, 1.0f, 0.0f, 0.0f };
+static const float DEFAULT_TEXCOORDS[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+static const float DEFAULT_TANGENT[4]   = { 1.0f, 0.0f, 0.0f, 0.0f };
+static const float DEFAULT_BITANGENT[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+
+struct AttributeStream {
+	const float * data;
+	size_t stride; // floats, 0 repeats a default
+};
+
+// Assimp declares aiVector3D packed, its arrays still come from new[] and are float aligned
+static AttributeStream Stream(const void * source, const float * fallback) {
+	AttributeStream stream;
+	stream.data = source ? (const float *) source : fallback;
+	stream.stride = source ? 3 : 0;
+	return stream;
+}
+
+static inline void CopyScalar(float * dst, const float * src, int n) {
+	for (int c=0; c<n; c++) dst[c] = src[c];
+}
+
+void ExtractVertices(const aiMesh * mesh, std::vector<Vertex> & vertices) {
+
+	static_assert(sizeof(Vertex) == 14 * sizeof(float), "Vertex must be 14 tightly packed floats");
+	static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "aiVector3D must be 3 floats");
+
+	size_t n = mesh->mNumVertices;
+	vertices.resize(n);
+	if (n == 0) return;
+
+	const AttributeStream position  = Stream(mesh->mVertices, DEFAULT_POSITION);
+	const AttributeStream normal    = Stream(mesh->mNormals, DEFAULT_NORMAL);
+	const AttributeStream texCoords = Stream(mesh->mTextureCoords[0], DEFAULT_TEXCOORDS);
+	const AttributeStream tangent   = Stream(mesh->mTangents, DEFAULT_TANGENT);
+	const AttributeStream bitangent = Stream(mesh->mBitangents, DEFAULT_BITANGENT);
+
+	const size_t POSITION  = offsetof(Vertex, position) / sizeof(float);
+	const size_t NORMAL    = offsetof(Vertex, normal) / sizeof(float);
+	const size_t TEXCOORDS = offsetof(Vertex, texCoords) / sizeof(float);
+	const size_t TANGENT   = offsetof(Vertex, tangent) / sizeof(float);
+	const size_t BITANGENT = offsetof(Vertex, bitangent) / sizeof(float);
+
+	float * out = &vertices[0].position.x;
+	size_t i = 0;
+
+#ifdef MESHIMPORT_SSE
+	// Every store but the texture coordinates' writes one float too many, into
+	// the next field or the next vertex's position; the last vertex goes scalar
+	// so neither the loads nor the stores run past the arrays
+	for (; i+1<n; i++, out+=14) {
+		_mm_storeu_ps(out + POSITION,  _mm_loadu_ps(position.data  + i * position.stride));
+		_mm_storeu_ps(out + NORMAL,    _mm_loadu_ps(normal.data    + i * normal.stride));
+		_mm_storel_pi((__m64 *) (out + TEXCOORDS), _mm_loadu_ps(texCoords.data + i * texCoords.stride));
+		_mm_storeu_ps(out + TANGENT,   _mm_loadu_ps(tangent.data   + i * tangent.stride));
+		_mm_storeu_ps(out + BITANGENT, _mm_loadu_ps(bitangent.data + i * bitangent.stride));
+	}
+#endif
+
+	for (; i<n; i++, out+=14) {
+		CopyScalar(out + POSITION,  position.data  + i * position.stride, 3);
+		CopyScalar(out + NORMAL,    normal.data    + i * normal.stride, 3);
+		CopyScalar(out + TEXCOORDS, texCoords.data + i * texCoords.stride, 2);
+		CopyScalar(out + TANGENT,   tangent.data   + i * tangent.stride, 3);
+		CopyScalar(out + BITANGENT, bitangent.data + i * bitangent.stride, 3);
+	}
+}
+
+/*************************************************
+* Indices
+*************************************************/
+
+static void ExtractAnyFaces(const aiMesh * mesh, std::vector<unsigned int> & indices) {
+	size_t count = 0;
+	for (unsigned int i=0; i<mesh->mNumFaces; i++)
+		count += mesh->mFaces[i].mNumIndices;
+	indices.resize(count);
+
+	unsigned int * out = indices.data();
+	for (unsigned int i=0; i<mesh->mNumFaces; i++) {
+		const aiFace & face = mesh->mFaces[i];
+		for (unsigned int j=0; j<face.mNumIndices; j++)
+			*out++ = face.mIndices[j];
+	}
+}
+
+bool ExtractIndices(const aiMesh * mesh, std::vector<unsigned int> & indices) {
+
+	// Sized for triangles up front; the first other face restarts on the general path
+	indices.resize((size_t) mesh->mNumFaces * 3);
+	unsigned int * out = indices.data();
+
+	for (unsigned int i=0; i<mesh->mNumFaces; i++, out+=3) {
+		const aiFace & face = mesh->mFaces[i];
+		if (face.mNumIndices != 3) {
+			ExtractAnyFaces(mesh, indices);
+			return false;
+		}
+		out[0] = face.mIndices[0];
+		out[1] = face.mIndices[1];
+		out[2] = face.mIndices[2];
+	}
+	return true;
+}
+
+/*************************************************
+* Mesh
+*************************************************/
+
+void ImportMesh(const aiMesh * mesh, unsigned int flags, ImportedMesh & out) {
+
+	std::vector<Vertex> & vertices = out.vertices;
+	std::vector<unsigned int> & indices = out.indices;
+	out.lods.clear();
+	out.welded = WeldStats();
+	out.before = out.after = VertexCacheStats();
+	std::fill(out.lodTriangles, out.lodTriangles + Mesh::MAX_LODS, 0);
+
+	// process vertex positions, normals and texture coords, then indices
+	ExtractVertices(mesh, vertices);
+	bool triangles = ExtractIndices(mesh, indices);
+
+	// Merge duplicate vertices so most meshes fit 16-bit indices
+	if (triangles)
+		out.welded = WeldMesh(vertices, indices);
+
+	// Reorder for the post-transform cache, overdraw and vertex fetch
+	if ((flags & MODEL_OPTIMIZE_MESH) && triangles) {
+		out.before = AnalyzeVertexCache(indices, vertices.size());
+		OptimizeMesh(vertices, indices);
+		out.after = AnalyzeVertexCache(indices, vertices.size());
+	}
+
+	// Coarser levels go after the full one in the same index list
+	std::vector<MeshLod> & lods = out.lods;
+	if ((flags & MODEL_GENERATE_LODS) && triangles) {
+		MeshLod lod = { 0, (unsigned int) indices.size(), 0.0f };
+		lods.push_back(lod);
+		out.lodTriangles[0] = indices.size() / 3;
+
+		std::vector<unsigned int> source(indices);
+		for (unsigned int l=1; l<Mesh::MAX_LODS; l++) {
+			size_t target = (lods[0].count >> l) / 3 * 3;
+			float error;
+			std::vector<unsigned int> lodIndices = SimplifyMesh(vertices, source, target, &error);
+			if (lodIndices.empty() || lodIndices.size() * 10 > source.size() * 9) break; // mostly locked
+
+			if (flags & MODEL_OPTIMIZE_MESH)
+				OptimizeVertexCache(lodIndices, vertices.size());
+
+			lod.first = (unsigned int) indices.size();
+			lod.count = (unsigned int) lodIndices.size();
+			lod.error = std::max(error, lods.back().error);
+			lods.push_back(lod);
+			out.lodTriangles[l] = lodIndices.size() / 3;
+
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+			source.swap(lodIndices);
+		}
+	}
+}
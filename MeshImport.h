@@ -0,0 +1,44 @@
+#ifndef MESHIMPORT_H
+#define MESHIMPORT_H
+
+#include <vector>
+
+#include <Mesh.h>
+#include <MeshOptimizer.h>
+
+struct aiMesh;
+
+/**
+* Bulk conversion of Assimp meshes into Vertex arrays and index lists.
+*
+* Attribute presence is resolved once per mesh: a missing attribute reads its
+* default through a zero stride, so the vertex loop has no branches. The loop
+* moves every aiVector3D with one unaligned SSE load and store; the stores run
+* in field order, so the fourth lane each one spills is overwritten by the next.
+*/
+
+// Resizes vertices to mesh->mNumVertices. Missing normals are +Y, tangents +X,
+// bitangents +Z and texture coordinates 0.
+void ExtractVertices(const aiMesh * mesh, std::vector<Vertex> & vertices);
+// Returns whether every face is a triangle; points and lines survive Triangulate
+bool ExtractIndices(const aiMesh * mesh, std::vector<unsigned int> & indices);
+
+/**
+* The CPU side of importing one mesh: extraction, welding, optimization and
+* LODs as the ModelFlags ask. Touches nothing but its arguments, so meshes of
+* a scene can be imported on several threads at once.
+*/
+
+struct ImportedMesh {
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices; // all levels of detail, back to back
+	std::vector<MeshLod> lods;         // empty without MODEL_GENERATE_LODS
+	WeldStats welded;
+	VertexCacheStats before;           // zero without MODEL_OPTIMIZE_MESH
+	VertexCacheStats after;
+	size_t lodTriangles[Mesh::MAX_LODS];
+};
+
+void ImportMesh(const aiMesh * mesh, unsigned int flags, ImportedMesh & out);
+
+#endif
@@ -0,0 +1,572 @@
+#include <MeshOptimizer.h>
+#include <Mesh.h>
+#include <Hash.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/*************************************************
+* Welding
+*************************************************/
+
+WeldStats WeldMesh(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+
+	WeldStats stats = {};
+	size_t numVertices = vertices.size();
+	const unsigned int empty = ~0u;
+
+	// Open addressing table of unique vertices, keyed by the hash of the whole record
+	size_t capacity = 1;
+	while (capacity < numVertices * 2) capacity <<= 1;
+	std::vector<unsigned int> table(capacity, empty);
+	std::vector<unsigned int> remap(numVertices);
+
+	for (size_t v=0; v<numVertices; v++) {
+		uint64_t hash = HashBytes(&vertices[v], sizeof(Vertex));
+		size_t slot = (size_t) (hash ^ (hash >> 32)) & (capacity - 1); // low bits alone only see low input bits
+		while (table[slot] != empty &&
+			std::memcmp(&vertices[table[slot]], &vertices[v], sizeof(Vertex)) != 0)
+			slot = (slot + 1) & (capacity - 1);
+		if (table[slot] == empty) table[slot] = (unsigned int) v;
+		remap[v] = table[slot];
+	}
+
+	// Drop triangles collapsed by welding as well as zero-area ones
+	size_t count = 0;
+	for (size_t t=0; t+2<indices.size(); t+=3) {
+		unsigned int a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+		if (a == b || b == c || c == a) continue;
+
+		const glm::vec3 & p0 = vertices[a].position;
+		const glm::vec3 & p1 = vertices[b].position;
+		const glm::vec3 & p2 = vertices[c].position;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		if (glm::dot(n, n) == 0.0f) continue;
+
+		indices[count++] = a;
+		indices[count++] = b;
+		indices[count++] = c;
+	}
+	stats.triangles = (indices.size() - count) / 3;
+	indices.resize(count);
+
+	// Compact, keeping the surviving vertices in their original order
+	std::vector<unsigned int> compact(numVertices, empty);
+	for (unsigned int index : indices) compact[index] = 0;
+
+	size_t numUnique = 0;
+	for (size_t v=0; v<numVertices; v++) {
+		if (compact[v] == empty) continue;
+		compact[v] = (unsigned int) numUnique;
+		vertices[numUnique++] = vertices[v];
+	}
+	stats.vertices = numVertices - numUnique;
+	vertices.resize(numUnique);
+
+	for (unsigned int & index : indices) index = compact[index];
+
+	return stats;
+}
+
+/*************************************************
+* Simplification
+*************************************************/
+
+/** Symmetric 4x4 plane quadric plus the accumulated area weight */
+struct Quadric {
+	double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww, weight;
+};
+
+static void QuadricAdd(Quadric & q, const Quadric & r) {
+	q.xx += r.xx; q.xy += r.xy; q.xz += r.xz; q.xw += r.xw;
+	q.yy += r.yy; q.yz += r.yz; q.yw += r.yw;
+	q.zz += r.zz; q.zw += r.zw;
+	q.ww += r.ww;
+	q.weight += r.weight;
+}
+
+static Quadric QuadricFromTriangle(const glm::vec3 & p0, const glm::vec3 & p1, const glm::vec3 & p2) {
+	glm::dvec3 n = glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0));
+	double area = glm::length(n);
+	Quadric q = {};
+	if (area == 0.0) return q;
+	n /= area;
+	double d = -glm::dot(n, glm::dvec3(p0));
+	q.xx = n.x * n.x * area; q.xy = n.x * n.y * area; q.xz = n.x * n.z * area; q.xw = n.x * d * area;
+	q.yy = n.y * n.y * area; q.yz = n.y * n.z * area; q.yw = n.y * d * area;
+	q.zz = n.z * n.z * area; q.zw = n.z * d * area;
+	q.ww = d * d * area;
+	q.weight = area;
+	return q;
+}
+
+/** Area weighted mean squared distance of p to the planes in q */
+static double QuadricError(const Quadric & q, const glm::vec3 & p) {
+	double x = p.x, y = p.y, z = p.z;
+	double e = q.xx * x * x + 2.0 * q.xy * x * y + 2.0 * q.xz * x * z + 2.0 * q.xw * x
+		+ q.yy * y * y + 2.0 * q.yz * y * z + 2.0 * q.yw * y
+		+ q.zz * z * z + 2.0 * q.zw * z
+		+ q.ww;
+	return q.weight > 0.0 ? std::fabs(e) / q.weight : 0.0;
+}
+
+struct Collapse {
+	unsigned int from, to;
+	double cost;
+};
+
+std::vector<unsigned int> SimplifyMesh(
+	const std::vector<Vertex> & vertices,
+	const std::vector<unsigned int> & indices,
+	size_t targetIndices,
+	float * error) {
+
+	size_t numVertices = vertices.size();
+	std::vector<unsigned int> result(indices);
+	double maxError = 0.0;
+	if (error) *error = 0.0f;
+	if (result.size() <= targetIndices) return result;
+
+	// Vertices sharing a position: the first one with that position represents them
+	const unsigned int empty = ~0u;
+	size_t capacity = 1;
+	while (capacity < numVertices * 2) capacity <<= 1;
+	std::vector<unsigned int> table(capacity, empty);
+	std::vector<unsigned int> canonical(numVertices);
+	std::vector<unsigned int> shared(numVertices, 0);
+
+	for (size_t v=0; v<numVertices; v++) {
+		uint64_t hash = HashBytes(&vertices[v].position, sizeof(glm::vec3));
+		size_t slot = (size_t) (hash ^ (hash >> 32)) & (capacity - 1);
+		while (table[slot] != empty && vertices[table[slot]].position != vertices[v].position)
+			slot = (slot + 1) & (capacity - 1);
+		if (table[slot] == empty) table[slot] = (unsigned int) v;
+		canonical[v] = table[slot];
+		shared[canonical[v]]++;
+	}
+
+	// Lock attribute seams and open borders, collapsing them would tear the surface
+	std::vector<char> lockedPosition(numVertices, 0);
+	for (size_t v=0; v<numVertices; v++)
+		if (shared[canonical[v]] > 1) lockedPosition[canonical[v]] = 1;
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(result.size());
+		for (size_t t=0; t+2<result.size(); t+=3) {
+			for (int k=0; k<3; k++) {
+				uint64_t a = canonical[result[t + k]], b = canonical[result[t + (k + 1) % 3]];
+				edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i=0; i<edges.size(); ) {
+			size_t j = i;
+			while (j < edges.size() && edges[j] == edges[i]) j++;
+			if (j - i == 1) {
+				lockedPosition[edges[i] >> 32] = 1;
+				lockedPosition[edges[i] & 0xffffffffu] = 1;
+			}
+			i = j;
+		}
+	}
+	std::vector<char> locked(numVertices);
+	for (size_t v=0; v<numVertices; v++) locked[v] = lockedPosition[canonical[v]];
+
+	std::vector<Quadric> quadrics(numVertices, Quadric());
+	for (size_t t=0; t+2<result.size(); t+=3) {
+		Quadric q = QuadricFromTriangle(
+			vertices[result[t]].position, vertices[result[t + 1]].position, vertices[result[t + 2]].position);
+		for (int k=0; k<3; k++) QuadricAdd(quadrics[result[t + k]], q);
+	}
+
+	std::vector<unsigned int> remap(numVertices);
+	std::vector<char> touched(numVertices);
+	std::vector<unsigned int> offsets(numVertices + 1), adjacency;
+	std::vector<Collapse> collapses;
+
+	// Each pass collapses the cheapest independent edges, then rebuilds the index list
+	while (result.size() > targetIndices) {
+
+		size_t numTriangles = result.size() / 3;
+
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (unsigned int index : result) offsets[index + 1]++;
+		for (size_t v=0; v<numVertices; v++) offsets[v + 1] += offsets[v];
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t=0; t<numTriangles; t++)
+			for (int k=0; k<3; k++)
+				adjacency[fill[result[t * 3 + k]]++] = (unsigned int) t;
+
+		collapses.clear();
+		for (size_t t=0; t<numTriangles; t++) {
+			for (int k=0; k<3; k++) {
+				unsigned int a = result[t * 3 + k], b = result[t * 3 + (k + 1) % 3];
+				Quadric q = quadrics[a];
+				QuadricAdd(q, quadrics[b]);
+				if (!locked[a]) collapses.push_back({ a, b, QuadricError(q, vertices[b].position) });
+				if (!locked[b]) collapses.push_back({ b, a, QuadricError(q, vertices[a].position) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse & x, const Collapse & y) { return x.cost < y.cost; });
+
+		for (size_t v=0; v<numVertices; v++) remap[v] = (unsigned int) v;
+		std::fill(touched.begin(), touched.end(), 0);
+
+		size_t need = (result.size() - targetIndices) / 3;
+		size_t removed = 0;
+
+		for (const Collapse & c : collapses) {
+			if (removed >= need) break;
+			if (touched[c.from] || touched[c.to]) continue;
+
+			// Reject collapses that flip or fold (over ~75 degrees) a remaining triangle
+			bool flips = false;
+			size_t lost = 0;
+			for (unsigned int i=offsets[c.from]; i<offsets[c.from + 1] && !flips; i++) {
+				const unsigned int * tri = &result[adjacency[i] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					lost++;
+					continue;
+				}
+				glm::vec3 p[3], q[3];
+				for (int k=0; k<3; k++) {
+					p[k] = vertices[tri[k]].position;
+					q[k] = tri[k] == c.from ? vertices[c.to].position : p[k];
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after  = glm::cross(q[1] - q[0], q[2] - q[0]);
+				if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) flips = true;
+			}
+			if (flips) continue;
+
+			// The whole 1-ring is frozen for this pass so the flip test stays valid
+			for (unsigned int i=offsets[c.from]; i<offsets[c.from + 1]; i++) {
+				const unsigned int * tri = &result[adjacency[i] * 3];
+				for (int k=0; k<3; k++) touched[tri[k]] = 1;
+			}
+
+			remap[c.from] = c.to;
+			QuadricAdd(quadrics[c.to], quadrics[c.from]);
+			maxError = std::max(maxError, c.cost);
+			removed += lost;
+		}
+
+		if (removed == 0) break; // everything left is locked or would flip
+
+		size_t count = 0;
+		for (size_t t=0; t<numTriangles; t++) {
+			unsigned int a = remap[result[t * 3]], b = remap[result[t * 3 + 1]], c = remap[result[t * 3 + 2]];
+			if (a == b || b == c || c == a) continue;
+			result[count++] = a;
+			result[count++] = b;
+			result[count++] = c;
+		}
+		result.resize(count);
+	}
+
+	if (error) *error = (float) std::sqrt(maxError);
+	return result;
+}
+
+/*************************************************
+* Analysis
+*************************************************/
+
+VertexCacheStats AnalyzeVertexCache(
+	const std::vector<unsigned int> & indices,
+	size_t numVertices,
+	unsigned int cacheSize) {
+
+	VertexCacheStats stats = {};
+	stats.triangles = indices.size() / 3;
+
+	// FIFO cache: a vertex is cached while fewer than cacheSize misses happened since it entered
+	std::vector<size_t> timestamp(numVertices, 0);
+	size_t time = cacheSize + 1;
+
+	for (unsigned int index : indices) {
+		if (timestamp[index] == 0) stats.vertices++;
+		if (time - timestamp[index] > cacheSize) {
+			timestamp[index] = time++;
+			stats.transformed++;
+		}
+	}
+
+	return stats;
+}
+
+/*************************************************
+* Vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+*************************************************/
+
+static const int FORSYTH_CACHE_SIZE = 32;
+static const int FORSYTH_MAX_VALENCE = 64;
+
+struct ForsythTables {
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_MAX_VALENCE];
+
+	ForsythTables() {
+		for (int i=0; i<FORSYTH_CACHE_SIZE; i++) {
+			if (i < 3) cache[i] = 0.75f; // the last triangle's vertices, no preference between them
+			else cache[i] = std::pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		for (int i=0; i<FORSYTH_MAX_VALENCE; i++)
+			valence[i] = i > 0 ? 2.0f * std::pow((float) i, -0.5f) : 0.0f;
+	}
+};
+
+static float VertexScore(const ForsythTables & tables, int cachePosition, unsigned int valence) {
+	if (valence == 0) return -1.0f; // no triangles left, never pick
+	float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+	score += tables.valence[std::min(valence, (unsigned int) FORSYTH_MAX_VALENCE - 1)];
+	return score;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int> & indices, size_t numVertices) {
+
+	static const ForsythTables tables;
+
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0) return;
+
+	// Vertex -> triangle adjacency, the first `live[v]` entries are not emitted yet
+	std::vector<unsigned int> live(numVertices, 0);
+	for (unsigned int index : indices) live[index]++;
+
+	std::vector<unsigned int> offsets(numVertices + 1, 0);
+	for (size_t v=0; v<numVertices; v++) offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t=0; t<numTriangles; t++)
+		for (int k=0; k<3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int) t;
+
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScore(numVertices);
+	for (size_t v=0; v<numVertices; v++)
+		vertexScore[v] = VertexScore(tables, -1, live[v]);
+
+	std::vector<float> triangleScore(numTriangles);
+	std::vector<char> emitted(numTriangles, 0);
+	int best = 0;
+	for (size_t t=0; t<numTriangles; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best]) best = (int) t;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+	int cacheCount = 0;
+	size_t cursor = 0;
+
+	while (output.size() < indices.size()) {
+
+		// Dead end: restart from the next triangle in input order
+		if (best < 0) {
+			while (emitted[cursor]) cursor++;
+			best = (int) cursor;
+		}
+
+		const unsigned int * tri = &indices[best * 3];
+		emitted[best] = 1;
+		output.insert(output.end(), tri, tri + 3);
+
+		// Remove the triangle from its vertices' live lists
+		for (int k=0; k<3; k++) {
+			unsigned int v = tri[k];
+			unsigned int * list = &adjacency[offsets[v]];
+			for (unsigned int i=0; i<live[v]; i++) {
+				if (list[i] == (unsigned int) best) {
+					std::swap(list[i], list[live[v] - 1]);
+					break;
+				}
+			}
+			live[v]--;
+		}
+
+		// LRU update: emitted vertices move to the front
+		int newCount = 0;
+		for (int k=0; k<3; k++) newCache[newCount++] = tri[k];
+		for (int i=0; i<cacheCount; i++) {
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore every vertex that moved, including the ones pushed out
+		cacheCount = 0;
+		for (int i=0; i<newCount; i++) {
+			unsigned int v = newCache[i];
+			int position = i < FORSYTH_CACHE_SIZE ? i : -1;
+			if (position >= 0) cache[cacheCount++] = v;
+
+			cachePosition[v] = position;
+			float score = VertexScore(tables, position, live[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned int * list = &adjacency[offsets[v]];
+			for (unsigned int j=0; j<live[v]; j++)
+				triangleScore[list[j]] += delta;
+		}
+
+		// Next triangle: the best one touching the cache
+		best = -1;
+		float bestScore = -1.0f;
+		for (int i=0; i<cacheCount; i++) {
+			unsigned int v = cache[i];
+			const unsigned int * list = &adjacency[offsets[v]];
+			for (unsigned int j=0; j<live[v]; j++) {
+				if (triangleScore[list[j]] > bestScore) {
+					bestScore = triangleScore[list[j]];
+					best = (int) list[j];
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+/*************************************************
+* Overdraw (Sander, Nehab, Barczak, "Fast Triangle Reordering for
+* Vertex Locality and Reduced Overdraw")
+*************************************************/
+
+static const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+static unsigned int TriangleMisses(const unsigned int * tri, std::vector<size_t> & timestamp, size_t & time) {
+	unsigned int misses = 0;
+	for (int k=0; k<3; k++) {
+		if (time - timestamp[tri[k]] > OVERDRAW_CACHE_SIZE) {
+			timestamp[tri[k]] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+void OptimizeOverdraw(
+	std::vector<unsigned int> & indices,
+	const std::vector<Vertex> & vertices,
+	float threshold) {
+
+	size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0) return;
+
+	// One timestamp array for every pass: advancing time past the cache size
+	// starts a pass with a cold cache, without clearing the array
+	std::vector<size_t> timestamp(vertices.size(), 0);
+	size_t time = OVERDRAW_CACHE_SIZE + 1;
+
+	// Hard boundaries: the cache-optimized order restarts wherever a triangle misses all 3 vertices
+	std::vector<size_t> hard;
+	for (size_t t=0; t<numTriangles; t++)
+		if (TriangleMisses(&indices[t * 3], timestamp, time) == 3 || t == 0)
+			hard.push_back(t);
+	hard.push_back(numTriangles);
+
+	// Soft boundaries: split hard clusters further while their ACMR stays within threshold
+	std::vector<size_t> clusters;
+	for (size_t c=0; c+1<hard.size(); c++) {
+		size_t start = hard[c], end = hard[c + 1];
+
+		time += OVERDRAW_CACHE_SIZE + 1;
+		size_t misses = 0;
+		for (size_t t=start; t<end; t++)
+			misses += TriangleMisses(&indices[t * 3], timestamp, time);
+		float clusterACMR = (float) misses / (end - start);
+
+		time += OVERDRAW_CACHE_SIZE + 1;
+		clusters.push_back(start);
+		size_t subStart = start, subMisses = 0;
+		for (size_t t=start; t<end; t++) {
+			subMisses += TriangleMisses(&indices[t * 3], timestamp, time);
+			size_t subSize = t + 1 - subStart;
+			if (t + 1 < end && subSize >= 8 && (float) subMisses / subSize <= threshold * clusterACMR) {
+				clusters.push_back(t + 1);
+				subStart = t + 1;
+				subMisses = 0;
+				time += OVERDRAW_CACHE_SIZE + 1; // the next cluster starts with a cold cache
+			}
+		}
+	}
+	clusters.push_back(numTriangles);
+
+	// Sort clusters so the ones facing away from the mesh center draw first
+	glm::vec3 meshCenter(0.0f);
+	for (const Vertex & vertex : vertices) meshCenter += vertex.position;
+	meshCenter /= (float) std::max<size_t>(vertices.size(), 1);
+
+	size_t numClusters = clusters.size() - 1;
+	std::vector<float> sortKey(numClusters);
+	for (size_t c=0; c<numClusters; c++) {
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t=clusters[c]; t<clusters[c + 1]; t++) {
+			const glm::vec3 & a = vertices[indices[t * 3]].position;
+			const glm::vec3 & b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3 & d = vertices[indices[t * 3 + 2]].position;
+			glm::vec3 n = glm::cross(b - a, d - a); // length is twice the area
+			float w = glm::length(n);
+			center += (a + b + d) / 3.0f * w;
+			normal += n;
+			area += w;
+		}
+		if (area > 0.0f) center /= area;
+		float length = glm::length(normal);
+		sortKey[c] = length > 0.0f ? glm::dot(center - meshCenter, normal / length) : 0.0f;
+	}
+
+	std::vector<size_t> order(numClusters);
+	for (size_t c=0; c<numClusters; c++) order[c] = c;
+	std::stable_sort(order.begin(), order.end(),
+		[&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t c : order)
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+	indices.swap(output);
+}
+
+/*************************************************
+* Vertex fetch
+*************************************************/
+
+void OptimizeVertexFetch(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+
+	// Number vertices in order of first use, unreferenced ones are dropped
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (unsigned int & index : indices) {
+		if (remap[index] == unused) {
+			remap[index] = (unsigned int) output.size();
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(output);
+}
+
+void OptimizeMesh(std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+}
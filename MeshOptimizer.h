@@ -0,0 +1,78 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include <cstddef>
+
+#include <Mesh.h>
+
+/**
+* Post-import optimization of indexed triangle lists.
+*
+* WeldMesh merges identical vertices and drops degenerate triangles.
+*
+* SimplifyMesh builds a coarser index list over the same vertices for LODs.
+*
+* OptimizeMesh runs the full stage:
+*   1. vertex cache reorder (Forsyth)
+*   2. overdraw-aware cluster ordering (Sander et al. / Tipsify style)
+*   3. vertex fetch reorder, so the vertex array is touched linearly
+*/
+
+struct VertexCacheStats {
+	size_t transformed; // vertex shader invocations with a FIFO post-transform cache
+	size_t triangles;
+	size_t vertices;    // referenced vertices
+
+	float ACMR() const { return triangles ? (float) transformed / triangles : 0.0f; }
+	float ATVR() const { return vertices ? (float) transformed / vertices : 0.0f; }
+};
+
+struct WeldStats {
+	size_t vertices;  // vertices removed
+	size_t triangles; // triangles removed
+};
+
+/**
+* Merge vertices whose Vertex records are bitwise identical, drop triangles that
+* reference a vertex twice or have zero area, and compact the vertex array.
+*/
+WeldStats WeldMesh(
+	std::vector<Vertex> & vertices,
+	std::vector<unsigned int> & indices);
+
+/**
+* Quadric error edge collapse (Garland and Heckbert) down to about targetIndices
+* indices. Vertices only collapse onto other existing vertices, so the result
+* indexes the same vertex array. Open borders and attribute seams are locked.
+* error receives the largest collapse error, in model space units.
+*/
+std::vector<unsigned int> SimplifyMesh(
+	const std::vector<Vertex> & vertices,
+	const std::vector<unsigned int> & indices,
+	size_t targetIndices,
+	float * error = NULL);
+
+VertexCacheStats AnalyzeVertexCache(
+	const std::vector<unsigned int> & indices,
+	size_t numVertices,
+	unsigned int cacheSize = 16);
+
+void OptimizeVertexCache(
+	std::vector<unsigned int> & indices,
+	size_t numVertices);
+
+void OptimizeOverdraw(
+	std::vector<unsigned int> & indices,
+	const std::vector<Vertex> & vertices,
+	float threshold = 1.05f);
+
+void OptimizeVertexFetch(
+	std::vector<Vertex> & vertices,
+	std::vector<unsigned int> & indices);
+
+void OptimizeMesh(
+	std::vector<Vertex> & vertices,
+	std::vector<unsigned int> & indices);
+
+#endif
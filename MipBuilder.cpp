@@ -0,0 +1,305 @@
+#include <MipBuilder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define MIPBUILDER_SSE
+#include <xmmintrin.h>
+#endif
+
+MipSettings DefaultMipSettings() {
+	MipSettings settings;
+	settings.filter = MIP_KAISER;
+	settings.srgb = false;
+	settings.normalMap = false;
+	settings.alphaCoverage = false;
+	settings.alphaReference = 0.5f;
+	return settings;
+}
+
+int NumMipLevels(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		levels++;
+	}
+	return levels;
+}
+
+/*************************************************
+* Conversion
+*************************************************/
+
+struct FloatImage {
+	int width, height;
+	std::vector<float> texels; // RGBA
+};
+
+static const int LINEAR_TABLE_SIZE = 4096;
+
+static float SrgbToLinear(float v) {
+	return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float v) {
+	return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+}
+
+// Static locals initialize once even with several decode workers
+static const std::vector<float> & SrgbDecodeTable() {
+	static const std::vector<float> table = [] {
+		std::vector<float> t(256);
+		for (int i=0; i<256; i++) t[i] = SrgbToLinear(i / 255.0f);
+		return t;
+	}();
+	return table;
+}
+
+static const std::vector<unsigned char> & SrgbEncodeTable() {
+	static const std::vector<unsigned char> table = [] {
+		std::vector<unsigned char> t(LINEAR_TABLE_SIZE + 1);
+		for (int i=0; i<=LINEAR_TABLE_SIZE; i++)
+			t[i] = (unsigned char) std::lround(LinearToSrgb((float) i / LINEAR_TABLE_SIZE) * 255.0f);
+		return t;
+	}();
+	return table;
+}
+
+static unsigned char ToUnorm8(float v) {
+	return (unsigned char) std::lround(std::min(std::max(v, 0.0f), 1.0f) * 255.0f);
+}
+
+static void ToFloat(const unsigned char * rgba, int width, int height,
+	const MipSettings & settings, FloatImage & image) {
+
+	const std::vector<float> & srgb = SrgbDecodeTable();
+	image.width = width;
+	image.height = height;
+	image.texels.resize((size_t) width * height * 4);
+
+	for (size_t i=0; i<(size_t) width * height * 4; i++) {
+		bool color = i % 4 != 3;
+		if (color && settings.normalMap)
+			image.texels[i] = rgba[i] * (2.0f / 255.0f) - 1.0f;
+		else if (color && settings.srgb)
+			image.texels[i] = srgb[rgba[i]];
+		else
+			image.texels[i] = rgba[i] * (1.0f / 255.0f);
+	}
+}
+
+static void ToBytes(const FloatImage & image, const MipSettings & settings, float alphaScale,
+	std::vector<unsigned char> & rgba) {
+
+	const std::vector<unsigned char> & srgb = SrgbEncodeTable();
+	rgba.resize(image.texels.size());
+
+	for (size_t i=0; i<image.texels.size(); i++) {
+		float v = image.texels[i];
+		bool color = i % 4 != 3;
+		if (!color)
+			rgba[i] = ToUnorm8(v * alphaScale);
+		else if (settings.normalMap)
+			rgba[i] = ToUnorm8(v * 0.5f + 0.5f);
+		else if (settings.srgb)
+			rgba[i] = srgb[(size_t) std::lround(std::min(std::max(v, 0.0f), 1.0f) * LINEAR_TABLE_SIZE)];
+		else
+			rgba[i] = ToUnorm8(v);
+	}
+}
+
+/*************************************************
+* Filters
+*************************************************/
+
+// dst = sum of weights[k] * src[k], one RGBA texel
+static inline void Accumulate(float * dst, const float * const * src, const float * weights, int taps) {
+#ifdef MIPBUILDER_SSE
+	__m128 sum = _mm_setzero_ps();
+	for (int k=0; k<taps; k++)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src[k]), _mm_set1_ps(weights[k])));
+	_mm_storeu_ps(dst, sum);
+#else
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int k=0; k<taps; k++)
+		for (int c=0; c<4; c++)
+			sum[c] += src[k][c] * weights[k];
+	for (int c=0; c<4; c++) dst[c] = sum[c];
+#endif
+}
+
+static void DownsampleBox(const FloatImage & src, FloatImage & dst) {
+
+	dst.width = std::max(src.width / 2, 1);
+	dst.height = std::max(src.height / 2, 1);
+	dst.texels.resize((size_t) dst.width * dst.height * 4);
+
+	const float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+	const float * taps[4];
+
+	for (int y=0; y<dst.height; y++) {
+		int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+		for (int x=0; x<dst.width; x++) {
+			int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+			taps[0] = &src.texels[((size_t) y0 * src.width + x0) * 4];
+			taps[1] = &src.texels[((size_t) y0 * src.width + x1) * 4];
+			taps[2] = &src.texels[((size_t) y1 * src.width + x0) * 4];
+			taps[3] = &src.texels[((size_t) y1 * src.width + x1) * 4];
+			Accumulate(&dst.texels[((size_t) y * dst.width + x) * 4], taps, weights, 4);
+		}
+	}
+}
+
+static const int KAISER_TAPS = 8;
+
+static double BesselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k=1; k<20; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+// Half band sinc under a Kaiser window, taps at -3.5 .. 3.5 source texels
+static const float * KaiserWeights() {
+	static const std::vector<float> weights = [] {
+		const double alpha = 4.0, radius = 4.0, pi = 3.14159265358979323846;
+		std::vector<float> w(KAISER_TAPS);
+		double sum = 0.0;
+		for (int k=0; k<KAISER_TAPS; k++) {
+			double d = k - 3.5;
+			double sinc = std::sin(pi * d / 2.0) / (pi * d / 2.0);
+			double r = d / radius;
+			double window = BesselI0(alpha * std::sqrt(1.0 - r * r)) / BesselI0(alpha);
+			w[k] = (float) (sinc * window);
+			sum += w[k];
+		}
+		for (float & v : w) v = (float) (v / sum);
+		return w;
+	}();
+	return weights.data();
+}
+
+// Separable: halve the width into tmp, then the height into dst. An axis of
+// one texel is passed through.
+static void DownsampleKaiser(const FloatImage & src, FloatImage & dst) {
+
+	const float * weights = KaiserWeights();
+	const float * taps[KAISER_TAPS];
+
+	FloatImage tmp;
+	tmp.width = std::max(src.width / 2, 1);
+	tmp.height = src.height;
+	tmp.texels.resize((size_t) tmp.width * tmp.height * 4);
+
+	for (int y=0; y<tmp.height; y++) {
+		const float * row = &src.texels[(size_t) y * src.width * 4];
+		for (int x=0; x<tmp.width; x++) {
+			float * out = &tmp.texels[((size_t) y * tmp.width + x) * 4];
+			if (src.width == 1) {
+				std::copy(row, row + 4, out);
+				continue;
+			}
+			for (int k=0; k<KAISER_TAPS; k++)
+				taps[k] = row + std::min(std::max(2 * x - 3 + k, 0), src.width - 1) * 4;
+			Accumulate(out, taps, weights, KAISER_TAPS);
+		}
+	}
+
+	dst.width = tmp.width;
+	dst.height = std::max(src.height / 2, 1);
+	dst.texels.resize((size_t) dst.width * dst.height * 4);
+
+	for (int y=0; y<dst.height; y++) {
+		for (int x=0; x<dst.width; x++) {
+			float * out = &dst.texels[((size_t) y * dst.width + x) * 4];
+			if (tmp.height == 1) {
+				std::copy(&tmp.texels[(size_t) x * 4], &tmp.texels[(size_t) x * 4] + 4, out);
+				continue;
+			}
+			for (int k=0; k<KAISER_TAPS; k++) {
+				int sy = std::min(std::max(2 * y - 3 + k, 0), tmp.height - 1);
+				taps[k] = &tmp.texels[((size_t) sy * tmp.width + x) * 4];
+			}
+			Accumulate(out, taps, weights, KAISER_TAPS);
+		}
+	}
+}
+
+static void Renormalize(FloatImage & image) {
+	for (size_t i=0; i<image.texels.size(); i+=4) {
+		float * n = &image.texels[i];
+		float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length > 1e-6f) {
+			n[0] /= length;
+			n[1] /= length;
+			n[2] /= length;
+		} else {
+			n[0] = n[1] = 0.0f;
+			n[2] = 1.0f;
+		}
+	}
+}
+
+/*************************************************
+* Alpha coverage
+*************************************************/
+
+static float AlphaCoverage(const FloatImage & image, float scale, float reference) {
+	size_t passed = 0;
+	for (size_t i=3; i<image.texels.size(); i+=4)
+		if (image.texels[i] * scale > reference) passed++;
+	return (float) passed / (float) (image.texels.size() / 4);
+}
+
+// Scale whose coverage is closest to the target, by bisection
+static float CoverageScale(const FloatImage & image, float target, float reference) {
+	float lo = 0.0f, hi = 4.0f;
+	for (int i=0; i<12; i++) {
+		float mid = 0.5f * (lo + hi);
+		if (AlphaCoverage(image, mid, reference) < target) lo = mid;
+		else hi = mid;
+	}
+	float below = target - AlphaCoverage(image, lo, reference);
+	float above = AlphaCoverage(image, hi, reference) - target;
+	return below < above ? lo : hi;
+}
+
+/*************************************************
+* Chain
+*************************************************/
+
+void BuildMips(const unsigned char * rgba, int width, int height,
+	const MipSettings & settings, std::vector<std::vector<unsigned char> > & levels) {
+
+	levels.assign(NumMipLevels(width, height), std::vector<unsigned char>());
+	levels[0].assign(rgba, rgba + (size_t) width * height * 4);
+	if (levels.size() == 1) return;
+
+	FloatImage current, next;
+	ToFloat(rgba, width, height, settings, current);
+
+	float coverage = settings.alphaCoverage ? AlphaCoverage(current, 1.0f, settings.alphaReference) : 0.0f;
+
+	// Each level filters the unscaled one above it, coverage scaling is output only
+	for (size_t level=1; level<levels.size(); level++) {
+		if (settings.filter == MIP_KAISER && !settings.normalMap)
+			DownsampleKaiser(current, next);
+		else
+			DownsampleBox(current, next);
+		if (settings.normalMap) Renormalize(next);
+
+		float alphaScale = 1.0f;
+		if (settings.alphaCoverage)
+			alphaScale = CoverageScale(next, coverage, settings.alphaReference);
+
+		ToBytes(next, settings, alphaScale, levels[level]);
+		current.texels.swap(next.texels);
+		current.width = next.width;
+		current.height = next.height;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef MIPBUILDER_H
+#define MIPBUILDER_H
+
+#include <vector>
+
+/**
+* Mip chains of 8-bit RGBA images, built on the CPU instead of glGenerateMipmap.
+*
+* Texels are filtered as floats, 4 channels per SSE register. sRGB color goes
+* through linear space and back, normal maps are filtered as vectors and
+* renormalized per level. With alpha coverage on, the alpha of every level is
+* scaled so the share of texels above alphaReference matches level 0, which
+* keeps alpha tested foliage from thinning out with distance.
+*/
+
+enum MipFilter {
+	MIP_BOX,   // 2x2 average
+	MIP_KAISER // 8-tap Kaiser windowed sinc, keeps distant levels sharper
+};
+
+struct MipSettings {
+	MipFilter filter;
+	bool srgb;          // RGB is sRGB encoded, alpha is always linear
+	bool normalMap;     // RGB holds a unit vector in [0, 255], always box filtered
+	bool alphaCoverage;
+	float alphaReference;
+};
+
+/** Methods */
+
+MipSettings DefaultMipSettings(); // Kaiser, linear color, no coverage, reference 0.5
+int NumMipLevels(int width, int height);
+
+// levels receives NumMipLevels images, levels[0] a copy of rgba, level i
+// max(width >> i, 1) x max(height >> i, 1) texels of 4 bytes each
+void BuildMips(const unsigned char * rgba, int width, int height,
+	const MipSettings & settings, std::vector<std::vector<unsigned char> > & levels);
+
+#endif
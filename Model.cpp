@@ -2,10 +2,19 @@
 #include <Mesh.h>
 #include <ShaderProgram.h>
 #include <Texture.h>
+#include <MeshCache.h>
+#include <MeshOptimizer.h>
+#include <MeshImport.h>
+#include <VertexFormat.h>
+#include <GeometryArena.h>
+#include <ThreadPool.h>
+#include <SceneGraph.h>
+#include <Material.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -14,39 +23,190 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// Resident set size of the process, 0 where unknown
+static size_t ResidentBytes() {
+#if defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+		return 0;
+	return (size_t) info.resident_size;
+#elif defined(_WIN32)
+	return 0;
+#else
+	FILE * file = std::fopen("/proc/self/statm", "r");
+	if (!file) return 0;
+	long pages = 0, resident = 0;
+	int fields = std::fscanf(file, "%ld %ld", &pages, &resident);
+	std::fclose(file);
+	return fields == 2 ? (size_t) resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+// Mesh processing of cold loads, the loading thread takes part as well
+static ThreadPool & ImportPool() {
+	static ThreadPool pool(std::max(ThreadPool::HardwareThreads(), 2u) - 1);
+	return pool;
+}
 
-Model :: Model(std::string path, bool gamma)
-	: gammaCorrection(gamma)
+Model :: Model(std::string path, bool gamma, unsigned int flags)
+	: lodThreshold(0.5f), gammaCorrection(gamma), flags(flags), welded(), lodTriangles(),
+	statsBefore(), statsAfter()
 {
 	//position = glm::vec3(0.0f, 0.0f, 0.0f);
 	//scale    = glm::vec3(1.0f, 1.0f, 1.0f);
 	//rotation = glm::mat4(1.0f);
 
-	loadModel(path);
+	// Geometry is processed in loadModel, after the textures are queued
+	ModelImport import;
+	readModel(path, flags, import);
+	loadModel(import);
 }
 
-Model :: ~Model() {
-	for (Mesh & mesh : meshes)
-		mesh.DeleteBuffers();
+Model :: Model(ModelImport & import, bool gamma)
+	: lodThreshold(0.5f), gammaCorrection(gamma), flags(import.flags), welded(), lodTriangles(),
+	statsBefore(), statsAfter()
+{
+	loadModel(import);
+}
+
+void Model :: Import(const std::string & path, unsigned int flags, ModelImport & import) {
+	readModel(path, flags, import);
+	processGeometry(import);
 }
 
 void Model :: Draw(Shader & shader) {
 
+	// Attach any textures decoded since the last frame
+	UploadTextures();
+	updatePlacements();
+
 	shader.use();
+	// Meshes share arena VAOs, consecutive ones of a format bind once
 	for (Mesh & mesh : meshes)
 		mesh.Draw(shader);
+	ArenaUnbind();
+}
+
+void Model :: Draw(Shader & shader, const glm::mat4 & modelMatrix, const Camera & camera) {
+
+	UploadTextures();
+	updatePlacements();
+
+	shader.use();
+	shader.setUniform("uModel", modelMatrix);
+	for (Mesh & mesh : meshes)
+		mesh.Draw(shader, selectLod(mesh, modelMatrix, camera));
+	ArenaUnbind();
+}
+
+void Model :: QueueTextures(TexturePacker & packer) {
+
+	packEntries.assign(meshes.size(), std::vector<unsigned int>());
+	for (size_t i=0; i<meshes.size(); i++) {
+		for (const Texture & texture : meshes[i].textures) {
+			// Default textures are loaded without gamma, see DefaultTexture
+			if (IsDefaultTexture(texture))
+				packEntries[i].push_back(packer.Add(InternedString(texture.path), false, texture.type));
+			else
+				packEntries[i].push_back(packer.Add(directory + InternedString(texture.path), gammaCorrection, texture.type));
+		}
+	}
 }
 
-void Model :: loadModel(std::string & path) {
+void Model :: UsePackedTextures(const TexturePacker & packer) {
+
+	for (size_t i=0; i<meshes.size() && i<packEntries.size(); i++) {
+		meshes[i].layers.clear();
+		for (unsigned int entry : packEntries[i])
+			meshes[i].layers.push_back(packer.Layer(entry));
+	}
+
+	shareMaterials();
+	textureRefs.clear();
+	textures_loaded.clear();
+	textureIds.clear();
+
+	TexturePackStats stats = packer.Stats();
+	std::cout << "Model::UsePackedTextures: " << stats.textures << " textures in "
+		<< stats.arrays << " arrays (" << stats.layers << " layers, "
+		<< stats.atlased << " atlas tiles on " << stats.atlasPages << " pages), "
+		<< stats.bytes / 1024 << " KB\n";
+}
+
+unsigned int Model :: selectLod(const Mesh & mesh, const glm::mat4 & modelMatrix, const Camera & camera) const {
+
+	if (mesh.NumLods() == 1) return 0;
+	if (mesh.instances.empty()) return placementLod(mesh, modelMatrix, camera);
+
+	// One draw covers every placement, the closest one decides
+	unsigned int lod = mesh.NumLods() - 1;
+	for (const glm::mat4 & instance : mesh.instances)
+		lod = std::min(lod, placementLod(mesh, modelMatrix * instance, camera));
+	return lod;
+}
+
+unsigned int Model :: placementLod(const Mesh & mesh, const glm::mat4 & modelMatrix, const Camera & camera) const {
+
+	// Bounding sphere of the mesh in world space
+	const MeshBounds & bounds = mesh.Bounds();
+	glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+		std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+	float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+
+	float distance = glm::length(center - camera.position);
+	if (distance <= radius) return 0;
+
+	// Fraction of the screen height the sphere covers
+	float size = radius / (distance * std::tan(glm::radians(camera.fov) * 0.5f));
+
+	unsigned int lod = 0;
+	float threshold = lodThreshold;
+	while (lod + 1 < mesh.NumLods() && size < threshold) {
+		lod++;
+		threshold *= 0.5f;
+	}
+	return lod;
+}
+
+void Model :: readModel(const std::string & path, unsigned int flags, ModelImport & import) {
 
 	/**
-	* Loads a model with supported ASSIMP extensions from file
-	* and stores resulting meshes in meshes vector
+	* Maps the mesh cache of a model file, or reads the file via ASSIMP and
+	* flattens its node tree when the cache is missing or stale
 	*/
 
+	auto start = std::chrono::steady_clock::now();
+
+	import.path = path;
+	import.flags = flags;
+
+	// Warm load: map the binary cache and skip ASSIMP entirely
+	import.cache.reset(new MeshCache);
+	if (import.cache->Open(path, flags & MODEL_CACHE_FLAGS)) {
+		import.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+	import.cache.reset();
+
 	// Read file via ASSIMP
-	Assimp::Importer importer;
-	const aiScene * scene = importer.ReadFile(path,
+	import.importer.reset(new Assimp::Importer);
+	const aiScene * scene = import.importer->ReadFile(path,
 		aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
 
 	/**
@@ -64,118 +224,286 @@ void Model :: loadModel(std::string & path) {
 		reducing drawing calls for optimization.
 	*/
 
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-		std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << "\n";
-		return;
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		std::cerr << "ERROR::ASSIMP::" << import.importer->GetErrorString() << "\n";
+	else {
+		// Work list of every mesh under the root node, each aiMesh once
+		import.scene = scene;
+		std::vector<int> slots(scene->mNumMeshes, -1);
+		processNode(scene->mRootNode, SceneGraph::NO_PARENT, slots, import);
 	}
 
-	// Retrieve directory path of filepath
-	directory = path.substr(0, path.find_last_of('/')) + "/";
+	import.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-	std::cout << "Model::loadModel: " << directory << "\n";
+void Model :: processGeometry(ModelImport & import) {
+
+	if (!import.scene || !import.geometry.empty()) return;
 
-	// Process ASSIMP's root node recursively
-	processNode(scene->mRootNode, scene);
+	// Geometry on the import pool, each mesh into its own slot
+	auto start = std::chrono::steady_clock::now();
+	std::vector<aiMesh *> & work = import.work;
+	std::vector<ImportedMesh> & geometry = import.geometry;
+	unsigned int flags = import.flags;
+
+	geometry.resize(work.size());
+	ImportPool().ParallelFor(work.size(), [&](size_t i) {
+		ImportMesh(work[i], flags, geometry[i]);
+	});
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	import.milliseconds += elapsed.count();
+	std::cout << "Model::loadModel: processed " << work.size() << " meshes on "
+		<< ImportPool().Size() + 1 << " threads in " << elapsed.count() << " ms\n";
 }
 
-void Model :: processNode(aiNode * node, const aiScene * scene) {
+void Model :: loadModel(ModelImport & import) {
 
 	/**
-	* Process a node in recursive fashion. Process each individual mesh located at node
-	* and repeats this process on its children nodes (if any).
+	* Builds the meshes of an import and stores them in meshes vector; processes
+	* the geometry first unless Import did already
 	*/
-	
-	// Process all the nodes' meshes
-	for (unsigned int i=0; i<node->mNumMeshes; i++) {
-		// Node object only contains indices to index the actual objects in the scene
-		// Scene contains all data, node is just to keep stuff organized (like relations between nodes).
-		aiMesh * mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene));
+
+	auto start = std::chrono::steady_clock::now();
+	const std::string & path = import.path;
+
+	// Retrieve directory path of filepath
+	directory = path.substr(0, path.find_last_of('/')) + "/";
+
+	if (import.cache) {
+		loadCache(*import.cache);
+		import.cache.reset();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << "Model::loadModel: " << path << " (warm) " << import.milliseconds + elapsed.count() << " ms\n";
+		printVertexStats();
+		printTextureStats();
+		return;
 	}
 
-	// then do the same for each of its children
-	for (unsigned int i=0; i<node->mNumChildren; i++) {
-		processNode(node->mChildren[i], scene);
+	if (!import.scene) return;
+
+	std::cout << "Model::loadModel: " << directory << "\n";
+
+	// Materials first, so textures decode while the geometry is processed
+	std::vector<std::vector<Texture> > materials(import.work.size());
+	for (size_t i=0; i<import.work.size(); i++)
+		materials[i] = processMaterial(import.work[i], import.scene);
+
+	processGeometry(import);
+
+	// GL buffers on this thread, in the order of the walk; a mesh placed by
+	// several nodes is uploaded once and drawn instanced
+	meshes.reserve(import.work.size());
+	for (size_t i=0; i<import.work.size(); i++)
+		processMesh(import.geometry[i], materials[i]);
+	import.geometry.clear();
+	shareMaterials();
+
+	// Everything needed from ASSIMP is copied out by now
+	import.importer.reset();
+	import.scene = NULL;
+	import.work.clear();
+
+	nodes = std::move(import.nodes);
+	placements = std::move(import.placements);
+	setupNodes();
+
+	// Cold load: record the result for the next run
+	if (!MeshCache::Write(path, meshes, nodes, placements, flags & MODEL_CACHE_FLAGS))
+		std::cerr << "Model::loadModel: Unable to write mesh cache for " << path << "\n";
+
+	// The cache was the last reader of the CPU copies
+	size_t cpuBytes = 0;
+	for (Mesh & mesh : meshes) {
+		if (flags & MODEL_COLLISION) mesh.BuildCollision();
+		cpuBytes += mesh.CpuBytes();
 	}
+	if (flags & MODEL_GPU_ONLY) {
+		size_t residentBefore = ResidentBytes();
+		for (Mesh & mesh : meshes) mesh.ReleaseCpuData();
+		size_t residentAfter = ResidentBytes();
+		size_t kept = 0;
+		for (const Mesh & mesh : meshes) kept += mesh.CpuBytes();
+		std::cout << "Model::loadModel: GPU only, CPU mesh data " << cpuBytes / 1024 << " KB -> "
+			<< kept / 1024 << " KB, RSS " << residentBefore / (1024 * 1024) << " MB -> "
+			<< residentAfter / (1024 * 1024) << " MB\n";
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Model::loadModel: " << path << " (cold) " << import.milliseconds + elapsed.count() << " ms\n";
+	size_t numPlacements = 0;
+	for (const std::vector<unsigned int> & meshNodes : placements) numPlacements += meshNodes.size();
+	std::cout << "Model::loadModel: " << meshes.size() << " unique meshes, "
+		<< numPlacements << " placements, " << nodes.Size() << " nodes\n";
+	std::cout << "Model::loadModel: welded " << welded.vertices << " vertices, dropped "
+		<< welded.triangles << " degenerate triangles\n";
+	if (flags & MODEL_OPTIMIZE_MESH)
+		std::cout << "Model::loadModel: ACMR " << statsBefore.ACMR() << " -> " << statsAfter.ACMR()
+			<< " ATVR " << statsBefore.ATVR() << " -> " << statsAfter.ATVR() << "\n";
+	if (flags & MODEL_GENERATE_LODS) {
+		std::cout << "Model::loadModel: LOD triangles";
+		for (unsigned int l=0; l<Mesh::MAX_LODS; l++) std::cout << " " << lodTriangles[l];
+		std::cout << "\n";
+	}
+	printVertexStats();
+	printTextureStats();
+}
+
+void Model :: printTextureStats() {
+	TextureCacheStats stats = GetTextureCacheStats();
+	std::cout << "Model::loadModel: texture cache hits " << stats.hits
+		<< " misses " << stats.misses << " textures " << stats.textures
+		<< " saved " << stats.bytesSaved / (1024.0 * 1024.0) << " MB\n";
 }
 
-Mesh Model :: processMesh(aiMesh * mesh, const aiScene * scene) {
+void Model :: printVertexStats() {
+	size_t numVertices = 0;
+	for (const Mesh & mesh : meshes) numVertices += mesh.NumVertices();
 
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
-	std::vector<Texture> textures;
+	std::cout << "Model::loadModel: vertex bytes";
+	for (int f=0; f<NUM_VERTEX_FORMATS; f++)
+		std::cout << " " << VertexFormatName[f] << " " << numVertices * VertexSize((VertexFormat) f);
+	std::cout << " (using " << VertexFormatName[vertexFormat()] << ")\n";
+}
 
-	// process vertex positions, normals and texture coords
-	for (unsigned int i=0; i<mesh->mNumVertices; i++) {
-		
-		Vertex vertex;
-		glm::vec3 v;
-
-		// Position
-		if (mesh->mVertices) {
-			v.x = mesh->mVertices[i].x;
-			v.y = mesh->mVertices[i].y;
-			v.z = mesh->mVertices[i].z;
-			vertex.position = v;
-		}
+VertexFormat Model :: vertexFormat() const {
+	if (!(flags & MODEL_COMPACT_VERTEX)) return VERTEX_FLOAT;
+	return flags & MODEL_UNORM_TEXCOORD ? VERTEX_COMPACT_UNORM_UV : VERTEX_COMPACT;
+}
 
-		// Normals
-		if (mesh->mNormals) {
-			v.x = mesh->mNormals[i].x;
-			v.y = mesh->mNormals[i].y;
-			v.z = mesh->mNormals[i].z;
-			vertex.normal = v;
-		} else {
-			//std::cerr << "Mesh::processMesh: Unable to load Normal: " << i << "\n";
-			vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-		}
+void Model :: loadCache(const MeshCache & cache) {
 
-		// Texture coordinates
-		if (mesh->mTextureCoords && mesh->mTextureCoords[0]) { // does mesh contain texture coords?
-			glm::vec2 u;
-			// A vertex can contain up to 8 texture coords. Assume that one won't use models
-			// where a vertex has multiple texture coords. So take first set (0).
-			u.x = mesh->mTextureCoords[0][i].x;
-			u.y = mesh->mTextureCoords[0][i].y;
-			vertex.texCoords = u;
-		} else {
-			//std::cerr << "Mesh::processMesh: Unable to load Texture: " << i << "\n";
-			vertex.texCoords = glm::vec2(0.0f, 0.0f);
+	/**
+	* Rebuild meshes from a MeshCache blob. Vertex and index arrays are uploaded
+	* directly from the mapping; only texture bindings need resolving.
+	*/
+
+	meshes.reserve(cache.NumMeshes());
+	for (unsigned int i=0; i<cache.NumMeshes(); i++) {
+
+		std::vector<Texture> textures;
+		for (const MeshCacheTexture & binding : cache.Textures(i)) {
+			Texture texture;
+			if (binding.isDefault)
+				textures.push_back(DefaultTexture(binding.type));
+			else if (loadTexture(binding.path, binding.type, texture))
+				textures.push_back(texture);
 		}
 
-		// Normals
-		if (mesh->mTangents) {
-			v.x = mesh->mTangents[i].x;
-			v.y = mesh->mTangents[i].y;
-			v.z = mesh->mTangents[i].z;
-			vertex.tangent = v;
+		meshes.emplace_back(
+			cache.Vertices(i), cache.NumVertices(i),
+			cache.Format(i), cache.Dequant(i),
+			cache.Indices(i), cache.NumIndices(i), cache.IndexType(i),
+			cache.Lods(i), cache.Bounds(i),
+			std::move(textures), (flags & MODEL_COLLISION) != 0);
+	}
+
+	for (unsigned int n=0; n<cache.NumNodes(); n++)
+		nodes.AddNode(cache.NodeParent(n), cache.NodeLocal(n), cache.NodeName(n));
+	placements.resize(meshes.size());
+	for (unsigned int i=0; i<cache.NumMeshes(); i++)
+		placements[i] = cache.Placements(i);
+	setupNodes();
+	shareMaterials();
+}
+
+void Model :: shareMaterials() {
+
+	/**
+	* One Material per distinct texture set: meshes of one aiMaterial (e.g. the
+	* pieces of sponza's fabric) share its record and its program bindings.
+	*/
+
+	std::unordered_map<uint64_t, std::shared_ptr<Material> > byKey;
+	size_t distinct = 0;
+	for (Mesh & mesh : meshes) {
+		std::shared_ptr<Material> material = std::make_shared<Material>(mesh.textures, mesh.layers);
+		std::shared_ptr<Material> & shared = byKey[material->Key()];
+		if (!shared) {
+			shared = material;
+			distinct++;
+		} else if (shared->SameAs(*material)) {
+			material = shared;
 		} else {
-			//std::cerr << "Mesh::processMesh: Unable to load Tangent: " << i << "\n";
-			vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+			distinct++; // hash collision, keep its own
 		}
+		mesh.SetMaterial(material);
+	}
+	std::cout << "Model::shareMaterials: " << distinct << " materials for " << meshes.size() << " meshes\n";
+}
 
-		// Binormals
-		if (mesh->mBitangents) {
-			v.x = mesh->mBitangents[i].x;
-			v.y = mesh->mBitangents[i].y;
-			v.z = mesh->mBitangents[i].z;
-			vertex.bitangent = v;
-		} else {
-			//std::cerr << "Mesh::processMesh: Unable to load Bitangent: " << i << "\n";
-			vertex.bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+void Model :: setupNodes() {
+
+	// Bounds of a node cover the meshes it places
+	for (size_t i=0; i<meshes.size() && i<placements.size(); i++) {
+		for (unsigned int node : placements[i]) {
+			MeshBounds bounds = meshes[i].Bounds();
+			if (nodes.HasBounds(node)) {
+				bounds.min = glm::min(bounds.min, nodes.Bounds(node).min);
+				bounds.max = glm::max(bounds.max, nodes.Bounds(node).max);
+			}
+			nodes.SetBounds(node, bounds);
 		}
+	}
+	updatePlacements();
+}
+
+void Model :: updatePlacements() {
+
+	// Refresh the instance transforms of meshes whose nodes moved
+	if (placements.size() != meshes.size() || nodes.Update() == 0) return;
+
+	for (size_t i=0; i<meshes.size(); i++) {
+		const std::vector<unsigned int> & meshNodes = placements[i];
+		bool changed = false;
+		for (unsigned int node : meshNodes) changed |= nodes.Changed(node);
+		if (!changed) continue;
 
-		vertices.push_back(vertex);
+		// A single placement at the origin draws without instancing
+		std::vector<glm::mat4> & instances = meshes[i].instances;
+		instances.clear();
+		if (meshNodes.size() == 1 && nodes.World(meshNodes[0]) == glm::mat4(1.0f)) continue;
+		for (unsigned int node : meshNodes)
+			instances.push_back(nodes.World(node));
 	}
+}
+
+void Model :: processNode(aiNode * node, int parent, std::vector<int> & slots, ModelImport & import) {
 
-	// process indices
-	for (unsigned int i=0; i<mesh->mNumFaces; i++) {
-		aiFace face = mesh->mFaces[i];
-		// Retrieve all indices of the face and store them in indices vector
-		for (unsigned int j=0; j<face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
+	/**
+	* Flatten the node tree into a list of meshes, in the order a recursive walk
+	* visits them: each node's own meshes, then its children's. Nodes go into the
+	* scene graph in the same order; a mesh referenced by several nodes gets one
+	* work item placed by every one of them.
+	*/
+
+	// aiMatrix4x4 is row major, and packed: copy it out instead of pointing into it
+	float rows[16];
+	std::memcpy(rows, &node->mTransformation, sizeof(rows));
+	glm::mat4 local = glm::transpose(glm::make_mat4(rows));
+	int index = import.nodes.AddNode(parent, local, node->mName.C_Str());
+	
+	for (unsigned int i=0; i<node->mNumMeshes; i++) {
+		// Node object only contains indices to index the actual objects in the scene
+		// Scene contains all data, node is just to keep stuff organized (like relations between nodes).
+		unsigned int mesh = node->mMeshes[i];
+		if (slots[mesh] < 0) {
+			slots[mesh] = (int) import.work.size();
+			import.work.push_back(import.scene->mMeshes[mesh]);
+			import.placements.push_back(std::vector<unsigned int>());
+		}
+		import.placements[slots[mesh]].push_back((unsigned int) index);
 	}
 
+	for (unsigned int i=0; i<node->mNumChildren; i++) {
+		processNode(node->mChildren[i], index, slots, import);
+	}
+}
+
+std::vector<Texture> Model :: processMaterial(aiMesh * mesh, const aiScene * scene) {
+
+	std::vector<Texture> textures;
+
 	// process material
 	if (mesh->mMaterialIndex >= 0) {
 
@@ -208,7 +536,27 @@ Mesh Model :: processMesh(aiMesh * mesh, const aiScene * scene) {
 		textures.insert(textures.end(), ambientMaps.begin(), ambientMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	return textures;
+}
+
+void Model :: processMesh(ImportedMesh & geometry, std::vector<Texture> & textures) {
+
+	welded.vertices  += geometry.welded.vertices;
+	welded.triangles += geometry.welded.triangles;
+
+	statsBefore.transformed += geometry.before.transformed;
+	statsBefore.triangles   += geometry.before.triangles;
+	statsBefore.vertices    += geometry.before.vertices;
+	statsAfter.transformed  += geometry.after.transformed;
+	statsAfter.triangles    += geometry.after.triangles;
+	statsAfter.vertices     += geometry.after.vertices;
+
+	for (unsigned int l=0; l<Mesh::MAX_LODS; l++)
+		lodTriangles[l] += geometry.lodTriangles[l];
+
+	// Built in place, the imported arrays move in without a copy
+	meshes.emplace_back(std::move(geometry.vertices), std::move(geometry.indices), std::move(textures),
+		vertexFormat(), std::move(geometry.lods));
 }
 
 std::vector<Texture> Model :: loadTextures(
@@ -228,40 +576,43 @@ std::vector<Texture> Model :: loadTextures(
 		aiString str;
 		material->GetTexture(aiTexType, i, &str);
 
-		// Check if texture was loaded before. Yes: continue.
-		bool skip = false;
-		for (unsigned int j=0; j<textures_loaded.size(); j++) {
-			if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-				textures.push_back(textures_loaded[j]);
-				skip == true; break;
-			}
-		}
-		if (skip) continue;
-
-		int tid = LoadTexture(directory + std::string(str.C_Str()), gammaCorrection);
-		if (tid <= 0) continue;
-
 		Texture texture;
-		texture.id = (unsigned int) tid;
-		texture.type = type;
-		texture.path = str.C_Str();
-		textures.push_back(texture);
-		textures_loaded.push_back(texture); // record to avoid repeated loading
-
-		std::cout << "Model::loadTextures: " << texture.id << "\t"
-			<< TextureTypeName[texture.type] << "\tfrom: " << texture.path << "\n";
+		if (loadTexture(str.C_Str(), type, texture))
+			textures.push_back(texture);
 	}
 
 	if (typeCount == 0 && (type == TEX_DIFFUSE || type == TEX_SPECULAR)) {
 		Texture texture = DefaultTexture(type);
 		textures.push_back(texture);
-		//std::cout << "Model::DefaultTexture: " << texture.id << "\t"
-		//	<< TextureTypeName[texture.type] << "\tfrom: " << texture.path << "\n";
+		//std::cout << "Model::DefaultTexture: " << TextureId(texture.handle) << "\t"
+		//	<< TextureTypeName[texture.type] << "\tfrom: " << InternedString(texture.path) << "\n";
 	}
 
 	return textures;
 }
 
+bool Model :: loadTexture(const std::string & path, TextureType type, Texture & texture) {
+
+	// Shared through the process-wide registry, decoded on the worker threads
+	// and attached by UploadTextures() in Draw
+	unsigned int tid = AcquireTexture(directory + path, gammaCorrection, true, type);
+	if (tid == 0) return false;
+
+	texture.handle = TextureHandleFor(tid);
+	texture.type = type;
+	texture.path = InternString(path);
+
+	// One reference and one entry per distinct texture, however many slots use it
+	if (!textureIds.insert(tid).second) {
+		ReleaseTexture(tid);
+		return true;
+	}
+	textures_loaded.push_back(texture);
+	textureRefs.push_back(TextureRef(tid)); // released on destruction
+
+	return true;
+}
+
 /**
 void Model :: Translate(glm::vec3 position) {
 	if (cnt_translate == 0)
@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <unordered_set>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -12,16 +14,73 @@
 #include <assimp/postprocess.h>
 
 #include <ShaderProgram.h>
+#include <EularCamera.h>
 #include <Texture.h>
+#include <TexturePacker.h>
 #include <Mesh.h>
+#include <MeshOptimizer.h>
+#include <MeshImport.h>
+#include <MeshCache.h>
+#include <VertexFormat.h>
+#include <SceneGraph.h>
+
+/** Import flags, the ones in MODEL_CACHE_FLAGS are part of the mesh cache key */
+enum ModelFlags {
+	MODEL_DEFAULT       = 0,
+	MODEL_OPTIMIZE_MESH = 1 << 0, // vertex cache, overdraw and vertex fetch reordering
+	MODEL_COMPACT_VERTEX = 1 << 1, // VERTEX_COMPACT, half float texCoords
+	MODEL_UNORM_TEXCOORD = 1 << 2, // with MODEL_COMPACT_VERTEX: VERTEX_COMPACT_UNORM_UV
+	MODEL_GENERATE_LODS  = 1 << 3, // simplified levels at about 1/2, 1/4 and 1/8 of the triangles
+	MODEL_GPU_ONLY       = 1 << 4, // free the CPU copies of vertices and indices once uploaded
+	MODEL_COLLISION      = 1 << 5, // positions-only copy for picking (Mesh::Collision)
+};
+
+const unsigned int MODEL_CACHE_FLAGS =
+	MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX | MODEL_UNORM_TEXCOORD | MODEL_GENERATE_LODS;
+
+/**
+* CPU half of a model load, filled by Model::Import on any thread: the mapped
+* mesh cache of a warm load, or the ASSIMP scene and its processed meshes of a
+* cold one. Model(ModelImport &) does the GL half.
+*/
+struct ModelImport {
+	std::string path;
+	unsigned int flags;
+	std::unique_ptr<MeshCache> cache;           // warm load
+	std::unique_ptr<Assimp::Importer> importer; // cold load, owns scene
+	const aiScene * scene;
+	std::vector<aiMesh *> work;                 // unique meshes in node walk order
+	SceneGraph nodes;                           // the aiNode tree
+	std::vector<std::vector<unsigned int> > placements; // nodes placing each work item
+	std::vector<ImportedMesh> geometry;         // one per work item, empty until processed
+	double milliseconds;                        // spent importing
+
+	ModelImport() : flags(0), scene(NULL), milliseconds(0.0) {}
+};
 
 class Model
 {
 public:
 	/** Methods */
-	Model(std::string path, bool gamma = false);
-	~Model();
+	// Returns once the geometry is uploaded, textures attach as they finish decoding
+	Model(std::string path, bool gamma = false, unsigned int flags = MODEL_DEFAULT);
+	// GL thread: builds the model from a finished import (see ModelLoader)
+	Model(ModelImport & import, bool gamma = false);
+	// Any thread: reads the file and processes its meshes, no GL calls
+	static void Import(const std::string & path, unsigned int flags, ModelImport & import);
 	void Draw(Shader & shader);
+	// Sets uModel and picks each mesh's LOD from its projected size
+	void Draw(Shader & shader, const glm::mat4 & modelMatrix, const Camera & camera);
+
+	// Texture packing: queue the textures of every model on one packer, Pack() it,
+	// then UsePackedTextures on each. Packed meshes sample MatTexLayer_t materials
+	// (shaders/demo_layered.frag), their 2D textures are released.
+	void QueueTextures(TexturePacker & packer);
+	void UsePackedTextures(const TexturePacker & packer);
+
+	// Node hierarchy of the file; SetLocal on a node moves the meshes below it
+	// from the next Draw on
+	SceneGraph & Nodes() { return nodes; }
 
 	//void Translate(glm::vec3 trans);
 	//void Translate(float x, float y, float z);
@@ -31,12 +90,38 @@ public:
 
 	/** Model Data */
 	std::vector<Mesh> meshes;
-	std::vector<Texture> textures_loaded; // store loaded textures to avoid loading twice
+	std::vector<Texture> textures_loaded; // textures acquired from the registry, see textureRefs
+
+	/** LOD params */
+	// Fraction of the screen height under which a mesh drops to LOD 1, halved for each further level
+	float lodThreshold;
 
 private:
 	/** Model Data */
 	std::string directory;
 	bool gammaCorrection;
+	unsigned int flags;
+
+	/** One registry reference per entry of textures_loaded */
+	std::vector<TextureRef> textureRefs;
+	std::unordered_set<unsigned int> textureIds; // registry ids in textures_loaded
+
+	/** Node hierarchy, and the nodes placing each mesh */
+	SceneGraph nodes;
+	std::vector<std::vector<unsigned int> > placements;
+
+	/** Packer entries of each mesh's textures, in the order of Mesh::textures */
+	std::vector<std::vector<unsigned int> > packEntries;
+
+	/** Vertices and triangles removed by welding on a cold load */
+	WeldStats welded;
+
+	/** Triangles per level of detail on a cold load */
+	size_t lodTriangles[Mesh::MAX_LODS];
+
+	/** Post-transform cache statistics of a cold load, before and after optimization */
+	VertexCacheStats statsBefore;
+	VertexCacheStats statsAfter;
 
 	/** Geometry params */
 	//glm::vec3 position;
@@ -47,13 +132,26 @@ private:
 	//unsigned int cnt_rotate;
 
 	/** Methods */
-	void loadModel(std::string & path);
-	void processNode(aiNode * node, const aiScene * scene);
-	Mesh processMesh(aiMesh * mesh, const aiScene * scene);
+	static void readModel(const std::string & path, unsigned int flags, ModelImport & import);
+	static void processGeometry(ModelImport & import);
+	void loadModel(ModelImport & import);
+	void loadCache(const MeshCache & cache);
+	void shareMaterials();
+	static void processNode(aiNode * node, int parent, std::vector<int> & slots, ModelImport & import);
+	std::vector<Texture> processMaterial(aiMesh * mesh, const aiScene * scene);
+	void processMesh(ImportedMesh & geometry, std::vector<Texture> & textures);
 	std::vector<Texture> loadTextures(
 		aiMaterial * material,
 		aiTextureType aiTexType, 
 		TextureType type);
+	bool loadTexture(const std::string & path, TextureType type, Texture & texture);
+	void setupNodes();
+	void updatePlacements();
+	void printTextureStats();
+	void printVertexStats();
+	VertexFormat vertexFormat() const;
+	unsigned int selectLod(const Mesh & mesh, const glm::mat4 & modelMatrix, const Camera & camera) const;
+	unsigned int placementLod(const Mesh & mesh, const glm::mat4 & modelMatrix, const Camera & camera) const;
 };
 
 #endif
\ No newline at end of file
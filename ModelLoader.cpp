@@ -0,0 +1,53 @@
+#include <ModelLoader.h>
+#include <Model.h>
+
+#include <chrono>
+#include <thread>
+
+ModelLoader :: ModelLoader(unsigned int numThreads)
+	: pending(0), pool(numThreads)
+{}
+
+ModelLoader :: ~ModelLoader() {
+	pool.Wait();
+	Job * job;
+	while (imported.Pop(job)) delete job;
+}
+
+unsigned int ModelLoader :: Submit(const std::string & path, bool gamma, unsigned int flags) {
+
+	unsigned int handle = (unsigned int) models.size();
+	models.push_back(std::shared_ptr<Model>());
+	pending++;
+
+	LockFreeQueue<Job *> * queue = &imported;
+	pool.Submit([queue, handle, path, gamma, flags] {
+		Job * job = new Job;
+		job->handle = handle;
+		job->gamma = gamma;
+		Model::Import(path, flags, job->import);
+		queue->Push(job);
+	});
+
+	return handle;
+}
+
+unsigned int ModelLoader :: Pump() {
+
+	unsigned int built = 0;
+	Job * job;
+	while (imported.Pop(job)) {
+		models[job->handle] = std::make_shared<Model>(job->import, job->gamma);
+		delete job;
+		pending--;
+		built++;
+	}
+	return built;
+}
+
+void ModelLoader :: Finish() {
+	while (pending > 0) {
+		if (Pump() == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
@@ -0,0 +1,54 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+
+#include <Model.h>
+#include <ThreadPool.h>
+#include <LockFreeQueue.h>
+
+/**
+* Loads several models at once. Submit queues a file and returns its handle;
+* file reading, ASSIMP parsing and mesh processing run on the loader's threads
+* (Model::Import), and Pump builds the finished ones on the GL thread in the
+* order they complete. Textures of all models go through the one process-wide
+* registry, so files shared between models decode once.
+*/
+
+class ModelLoader {
+
+public:
+	/** Methods */
+	explicit ModelLoader(unsigned int numThreads = 0); // 0: one per hardware thread
+	~ModelLoader(); // waits for imports in flight, drops the unbuilt ones
+
+	unsigned int Submit(const std::string & path, bool gamma = false, unsigned int flags = MODEL_DEFAULT);
+	// GL thread: builds the models imported since the last call, returns how many
+	unsigned int Pump();
+	// GL thread: pumps until every submitted model is built
+	void Finish();
+
+	// Null until Pump built it
+	std::shared_ptr<Model> Get(unsigned int handle) const { return models[handle]; }
+	unsigned int Pending() const { return pending; }
+
+private:
+	struct Job {
+		unsigned int handle;
+		bool gamma;
+		ModelImport import;
+	};
+
+	// Declared before the pool so it outlives the workers
+	LockFreeQueue<Job *> imported;
+	std::vector<std::shared_ptr<Model> > models;
+	unsigned int pending;
+	ThreadPool pool;
+
+	ModelLoader(const ModelLoader &);
+	ModelLoader & operator=(const ModelLoader &);
+};
+
+#endif
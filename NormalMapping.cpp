@@ -68,7 +68,7 @@ int main() {
 	//Model objectIndustrialFansModel("Resources/IndustrialFans/IndustrialFans.obj");
 	//Model objectNanosuit("Resources/nanosuit/nanosuit.obj");
 
-	Model objectCyborg("Resources/cyborg/cyborg.obj");
+	Model objectCyborg("Resources/cyborg/cyborg.obj", false, MODEL_COMPACT_VERTEX);
 
 	Plane objectFloor;
 	objectFloor.AddTexture("Resources/default/brickwall.jpg", TEX_DIFFUSE,  true);
@@ -266,8 +266,7 @@ void renderScene(Shader &shader, Plane & plane, Cube & cube, Model & obj)
 	model = glm::scale(model, glm::vec3(50.0f));
 	shader.use();
 	shader.setUniform("uModel", model);
-	glBindVertexArray(plane.VAO());
-	glDrawElements(GL_TRIANGLES, plane.indices.size(), GL_UNSIGNED_INT, 0);
+	plane.Draw(shader);
 	// cubes
 	model = glm::mat4();
 	model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
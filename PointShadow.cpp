@@ -200,6 +200,22 @@ int main() {
 	// Shadow map
 	objectShader.setUniform("uShadowMap", (int) depthMapTexUnit);
 
+	// per-frame uniforms, resolved once
+	// ---------------------------------
+	UniformHandle uDepthFarPlane      = simpleDepthShader.uniformHandle("uFarPlane");
+	UniformHandle uDepthLightPos      = simpleDepthShader.uniformHandle("uLightPos");
+	UniformHandle uShadowMatrices     = simpleDepthShader.uniformHandle("uShadowMatrices");
+	UniformHandle uView               = objectShader.uniformHandle("uView");
+	UniformHandle uProjection         = objectShader.uniformHandle("uProjection");
+	UniformHandle uCameraPos          = objectShader.uniformHandle("uCameraPos");
+	UniformHandle uBlinn              = objectShader.uniformHandle("uBlinn");
+	UniformHandle uGamma              = objectShader.uniformHandle("uGamma");
+	UniformHandle uTorch              = objectShader.uniformHandle("uTorch");
+	UniformHandle uFarPlane           = objectShader.uniformHandle("uFarPlane");
+	UniformHandle uPointLightPosition = objectShader.uniformHandle("uPointLight.position");
+	UniformHandle uSpotLightPosition  = objectShader.uniformHandle("uSpotLight.position");
+	UniformHandle uSpotLightDirection = objectShader.uniformHandle("uSpotLight.direction");
+
 	float aspect = (float) gWindowWidth / (float) gWindowHeight;
 
 	// render loop
@@ -232,10 +248,9 @@ int main() {
 		depthMap.Bind();
 		glClear(GL_DEPTH_BUFFER_BIT);
 		simpleDepthShader.use();
-		simpleDepthShader.setUniform("uFarPlane", depthMap.far);
-		simpleDepthShader.setUniform("uLightPos", lightPos);
-		for (int i = 0; i < 6; i++)
-			simpleDepthShader.setUniform("uShadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+		simpleDepthShader.setUniform(uDepthFarPlane, depthMap.far);
+		simpleDepthShader.setUniform(uDepthLightPos, lightPos);
+		simpleDepthShader.setUniform(uShadowMatrices, shadowTransforms.data(), 6);
 		renderScene(simpleDepthShader);
 		depthMap.Unbind();
 
@@ -252,18 +267,18 @@ int main() {
 		glm::mat4 view = camera.getViewMatrix();
 		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), aspect, 0.1f, 100.0f);
 		objectShader.use();
-		objectShader.setUniform("uView", view);
-		objectShader.setUniform("uProjection", projection);
-		objectShader.setUniform("uCameraPos", camera.position);
-		objectShader.setUniform("uBlinn", use_blinn);
-		objectShader.setUniform("uGamma", use_gamma);
-		objectShader.setUniform("uTorch", use_torch);
-		objectShader.setUniform("uFarPlane", depthMap.far);
+		objectShader.setUniform(uView, view);
+		objectShader.setUniform(uProjection, projection);
+		objectShader.setUniform(uCameraPos, camera.position);
+		objectShader.setUniform(uBlinn, use_blinn);
+		objectShader.setUniform(uGamma, use_gamma);
+		objectShader.setUniform(uTorch, use_torch);
+		objectShader.setUniform(uFarPlane, depthMap.far);
 		// set point light
-		objectShader.setUniform("uPointLight.position", lightPos);
+		objectShader.setUniform(uPointLightPosition, lightPos);
 		// set spot light
-		objectShader.setUniform("uSpotLight.position", camera.position);
-		objectShader.setUniform("uSpotLight.direction", camera.front);
+		objectShader.setUniform(uSpotLightPosition, camera.position);
+		objectShader.setUniform(uSpotLightDirection, camera.front);
 		// bind shadow map texture
 		glActiveTexture(GL_TEXTURE0 + depthMapTexUnit);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, depthMap.TID());
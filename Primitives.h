@@ -4,6 +4,8 @@
 #include <ShaderProgram.h>
 #include <Texture.h>
 #include <Mesh.h>
+#include <GeometryArena.h>
+#include <Material.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -21,16 +23,17 @@ public:
 
 	/** Methods */
 	Base2D();
-	~Base2D();
 
 	void Draw(Shader & shader);
 	void AddTexture(unsigned int tid);
 	void AddTexture(const std::string path, TextureType type, bool gamma = false);
 	void DeleteBuffers();
+	// GPU-only residency: frees vertices and indices, Draw keeps working
+	void ReleaseCpuData();
 
-	unsigned int VBO() { return vbo; }
-	unsigned int VAO() { return vao; }
-	unsigned int EBO() { return ebo; }
+	unsigned int VBO() { return ArenaGetRange(allocation.Id()).vbo; }
+	unsigned int VAO() { return ArenaGetRange(allocation.Id()).vao; }
+	unsigned int EBO() { return ArenaGetRange(allocation.Id()).ebo; }
 
 	//void Translate(glm::vec3 trans);
 	//void Translate(float x, float y, float z);
@@ -39,8 +42,11 @@ public:
 	//void Rotate(float radian, glm::vec3 axis);
 
 protected:
-	/** Render Data */
-	unsigned int vbo, ebo, vao;
+	/** Render Data, freed with the object; copies would free them twice, so it is move-only */
+	ArenaHandle allocation;
+	GLsizei numIndices;
+	std::vector<TextureRef> textureRefs; // textures added by path
+	Material material;                   // of textures, rebuilt by AddTexture
 
 	/** Geometry params 
 	glm::vec3 position;
@@ -75,16 +81,17 @@ public:
 
 	/** Methods */
 	Base3D();
-	~Base3D();
 
 	void Draw(Shader & shader);
 	void AddTexture(unsigned int tid);
 	void AddTexture(const std::string path, TextureType type, bool gamma = false);
 	void DeleteBuffers();
+	// GPU-only residency: frees vertices and indices, Draw keeps working
+	void ReleaseCpuData();
 
-	unsigned int VBO() { return vbo; }
-	unsigned int VAO() { return vao; }
-	unsigned int EBO() { return ebo; }
+	unsigned int VBO() { return ArenaGetRange(allocation.Id()).vbo; }
+	unsigned int VAO() { return ArenaGetRange(allocation.Id()).vao; }
+	unsigned int EBO() { return ArenaGetRange(allocation.Id()).ebo; }
 
 	//void Translate(glm::vec3 trans);
 	//void Translate(float x, float y, float z);
@@ -93,8 +100,11 @@ public:
 	//void Rotate(float radian, glm::vec3 axis);
 
 protected:
-	/** Render Data */
-	unsigned int vbo, ebo, vao;
+	/** Render Data, freed with the object; copies would free them twice, so it is move-only */
+	ArenaHandle allocation;
+	GLsizei numIndices;
+	std::vector<TextureRef> textureRefs; // textures added by path
+	Material material;                   // of textures, rebuilt by AddTexture
 
 	/** Geometry params 
 	glm::vec3 position;
@@ -0,0 +1,168 @@
+#include <SceneGraph.h>
+#include <Mesh.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <string>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SCENEGRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+/*************************************************
+* Transforms
+*************************************************/
+
+// out = a * b, column major; out aliases neither
+static void Multiply(const glm::mat4 & a, const glm::mat4 & b, glm::mat4 & out) {
+
+#ifdef SCENEGRAPH_SSE
+	const float * pa = &a[0][0];
+	const float * pb = &b[0][0];
+	float * po = &out[0][0];
+
+	// Each column of the product mixes the columns of a by one column of b
+	__m128 a0 = _mm_loadu_ps(pa);
+	__m128 a1 = _mm_loadu_ps(pa + 4);
+	__m128 a2 = _mm_loadu_ps(pa + 8);
+	__m128 a3 = _mm_loadu_ps(pa + 12);
+	for (int j=0; j<4; j++) {
+		const float * column = pb + 4 * j;
+		__m128 r = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+		_mm_storeu_ps(po + 4 * j, r);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+// Axis aligned box around the transformed box
+static MeshBounds TransformBounds(const glm::mat4 & m, const MeshBounds & local) {
+
+	glm::vec3 center = (local.min + local.max) * 0.5f;
+	glm::vec3 extent = (local.max - local.min) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent(0.0f);
+	for (int c=0; c<3; c++) {
+		glm::vec3 axis = glm::vec3(m[c]);
+		worldExtent += glm::abs(axis) * extent[c];
+	}
+
+	MeshBounds world = { worldCenter - worldExtent, worldCenter + worldExtent };
+	return world;
+}
+
+/*************************************************
+* SceneGraph
+*************************************************/
+
+SceneGraph :: SceneGraph() : serial(0) {}
+
+int SceneGraph :: AddNode(int parent, const glm::mat4 & local, const std::string & name) {
+
+	unsigned int node = (unsigned int) parents.size();
+
+	// Keeps every subtree contiguous: the parent must still be open
+	if (parent != NO_PARENT && (parent < 0 || (unsigned int) parent >= node || subtreeEnds[parent] != node))
+		return -1;
+
+	parents.push_back(parent);
+	subtreeEnds.push_back(node + 1);
+	names.push_back(name);
+	locals.push_back(local);
+	worlds.push_back(local);
+	bounds.push_back(MeshBounds());
+	worldBounds.push_back(MeshBounds());
+	hasBounds.push_back(0);
+	dirty.push_back(0);
+	updated.push_back(0);
+
+	for (int p=parent; p!=NO_PARENT; p=parents[p])
+		subtreeEnds[p] = node + 1;
+
+	markDirty(node);
+	return (int) node;
+}
+
+void SceneGraph :: Clear() {
+	parents.clear();
+	subtreeEnds.clear();
+	names.clear();
+	locals.clear();
+	worlds.clear();
+	bounds.clear();
+	worldBounds.clear();
+	hasBounds.clear();
+	dirty.clear();
+	updated.clear();
+	dirtyRoots.clear();
+}
+
+void SceneGraph :: SetLocal(unsigned int node, const glm::mat4 & local) {
+	locals[node] = local;
+	markDirty(node);
+}
+
+void SceneGraph :: SetBounds(unsigned int node, const MeshBounds & nodeBounds) {
+	bounds[node] = nodeBounds;
+	hasBounds[node] = 1;
+	markDirty(node);
+}
+
+int SceneGraph :: Find(const std::string & name) const {
+	for (size_t i=0; i<names.size(); i++)
+		if (names[i] == name) return (int) i;
+	return -1;
+}
+
+void SceneGraph :: markDirty(unsigned int node) {
+	if (dirty[node]) return;
+	dirty[node] = 1;
+	dirtyRoots.push_back(node);
+}
+
+unsigned int SceneGraph :: Update() {
+
+	serial++;
+	if (dirtyRoots.empty()) return 0;
+
+	// In index order a dirty ancestor comes first and its range covers the
+	// dirty nodes below it, so each changed subtree is computed once
+	std::sort(dirtyRoots.begin(), dirtyRoots.end());
+
+	unsigned int computed = 0;
+	unsigned int covered = 0;
+	for (unsigned int root : dirtyRoots) {
+		dirty[root] = 0;
+		if (root < covered) continue;
+		updateRange(root, subtreeEnds[root]);
+		computed += subtreeEnds[root] - root;
+		covered = subtreeEnds[root];
+	}
+	dirtyRoots.clear();
+
+	return computed;
+}
+
+void SceneGraph :: updateRange(unsigned int first, unsigned int end) {
+
+	// Parents precede their children, so every parent world is final when read
+	for (unsigned int i=first; i<end; i++) {
+		if (parents[i] == NO_PARENT)
+			worlds[i] = locals[i];
+		else
+			Multiply(worlds[parents[i]], locals[i], worlds[i]);
+		updated[i] = serial;
+	}
+
+	for (unsigned int i=first; i<end; i++)
+		if (hasBounds[i]) worldBounds[i] = TransformBounds(worlds[i], bounds[i]);
+}
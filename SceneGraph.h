@@ -0,0 +1,74 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <Mesh.h>
+
+/**
+* Transform hierarchy, e.g. the aiNode tree of a model or the objects of a demo.
+*
+* Nodes are stored structure of arrays in depth-first order, so the subtree of
+* a node is the contiguous range [node, SubtreeEnd(node)). SetLocal only marks
+* the node dirty; Update recomputes the world matrices (and world bounds) of the
+* dirty subtrees, one SSE pass over each range, and leaves the rest alone. The
+* per-frame cost follows the number of changed nodes, not the size of the graph.
+*/
+
+class SceneGraph {
+public:
+	static const int NO_PARENT = -1;
+
+	SceneGraph();
+
+	// Depth-first: parent is NO_PARENT, the last node added or one of its
+	// ancestors. Returns the node index, -1 when parent breaks the order.
+	int AddNode(int parent, const glm::mat4 & local, const std::string & name = "");
+	void Clear();
+
+	void SetLocal(unsigned int node, const glm::mat4 & local);
+	// Content of the node in its own space, world bounds follow its transform
+	void SetBounds(unsigned int node, const MeshBounds & bounds);
+
+	// Returns the number of world matrices recomputed
+	unsigned int Update();
+
+	size_t Size() const { return parents.size(); }
+	int Parent(unsigned int node) const { return parents[node]; }
+	unsigned int SubtreeEnd(unsigned int node) const { return subtreeEnds[node]; }
+	const std::string & Name(unsigned int node) const { return names[node]; }
+	const glm::mat4 & Local(unsigned int node) const { return locals[node]; }
+	const glm::mat4 & World(unsigned int node) const { return worlds[node]; } // as of the last Update
+	bool HasBounds(unsigned int node) const { return hasBounds[node] != 0; }
+	const MeshBounds & Bounds(unsigned int node) const { return bounds[node]; }
+	const MeshBounds & WorldBounds(unsigned int node) const { return worldBounds[node]; }
+	// Whether the last Update recomputed the node's world matrix
+	bool Changed(unsigned int node) const { return updated[node] == serial; }
+	// First node of that name, -1 if none
+	int Find(const std::string & name) const;
+
+private:
+	/** Node data, one entry per node */
+	std::vector<int> parents;
+	std::vector<unsigned int> subtreeEnds;
+	std::vector<std::string> names;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<MeshBounds> bounds;      // node space
+	std::vector<MeshBounds> worldBounds;
+	std::vector<unsigned char> hasBounds;
+	std::vector<unsigned char> dirty;
+	std::vector<uint32_t> updated;       // serial of the last Update that touched the node
+
+	std::vector<unsigned int> dirtyRoots; // nodes marked dirty since the last Update
+	uint32_t serial;
+
+	void markDirty(unsigned int node);
+	void updateRange(unsigned int first, unsigned int end);
+};
+
+#endif
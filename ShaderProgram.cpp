@@ -2,9 +2,33 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 using std::string;
 
+static SlotArray<GLuint, ProgramTag> programs;
+
+static UniformStats uniformStats = { 0, 0 };
+
+UniformStats GetUniformStats()
+{
+	return uniformStats;
+}
+
+void ResetUniformStats()
+{
+	uniformStats.issued = 0;
+	uniformStats.skipped = 0;
+}
+
+GLuint ProgramId(ProgramHandle handle)
+{
+	const GLuint * id = programs.Get(handle);
+	return id ? *id : 0;
+}
+
 //-----------------------------------------------------------------------------
 // Constructor
 //-----------------------------------------------------------------------------
@@ -27,6 +51,7 @@ Shader :: Shader(
 Shader :: ~Shader()
 {
 	// Delete the program
+	programs.Remove(mProgram);
 	glDeleteProgram(mHandle);
 }
 
@@ -74,12 +99,17 @@ bool Shader::loadShaders(
 	glLinkProgram(mHandle);
 	checkCompileErrors(mHandle, PROGRAM);
 
+	programs.Remove(mProgram);
+	mProgram = programs.Insert(mHandle);
+
 	glDeleteShader(vs);
 	glDeleteShader(fs);
 	if (gsFilename)
 		glDeleteShader(gs);
 
 	mUniformLocations.clear();
+	mShadow.clear();
+	reflectUniforms();
 
 	return true;
 }
@@ -168,13 +198,20 @@ GLuint Shader :: ID() const
 	return mHandle;
 }
 
+ProgramHandle Shader :: Handle() const
+{
+	return mProgram;
+}
+
 //-----------------------------------------------------------------------------
 // Sets a boolean shader uniform
 //-----------------------------------------------------------------------------
 void Shader :: setUniform(const string& name, bool value)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform1i(loc, (int) value);
+	int v = (int) value;
+	if (uploadNeeded(loc, &v, sizeof(v)))
+		glUniform1i(loc, v);
 }
 
 //-----------------------------------------------------------------------------
@@ -183,7 +220,8 @@ void Shader :: setUniform(const string& name, bool value)
 void Shader :: setUniform(const string& name, int value)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform1i(loc, value);
+	if (uploadNeeded(loc, &value, sizeof(value)))
+		glUniform1i(loc, value);
 }
 
 //-----------------------------------------------------------------------------
@@ -192,7 +230,8 @@ void Shader :: setUniform(const string& name, int value)
 void Shader :: setUniform(const string& name, float value)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform1f(loc, value);
+	if (uploadNeeded(loc, &value, sizeof(value)))
+		glUniform1f(loc, value);
 }
 
 //-----------------------------------------------------------------------------
@@ -201,13 +240,16 @@ void Shader :: setUniform(const string& name, float value)
 void Shader :: setUniform(const string& name, const glm::vec2& v)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform2fv(loc, 1, &v[0]);
+	if (uploadNeeded(loc, &v[0], sizeof(v)))
+		glUniform2fv(loc, 1, &v[0]);
 }
 
 void Shader :: setUniform(const string& name, float x, float y)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform2f(loc, x, y);
+	const GLfloat v[2] = { x, y };
+	if (uploadNeeded(loc, v, sizeof(v)))
+		glUniform2fv(loc, 1, v);
 }
 
 //-----------------------------------------------------------------------------
@@ -216,13 +258,16 @@ void Shader :: setUniform(const string& name, float x, float y)
 void Shader :: setUniform(const string& name, const glm::vec3& v)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform3fv(loc, 1, &v[0]);
+	if (uploadNeeded(loc, &v[0], sizeof(v)))
+		glUniform3fv(loc, 1, &v[0]);
 }
 
 void Shader :: setUniform(const string& name, float x, float y, float z)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform3f(loc, x, y, z);
+	const GLfloat v[3] = { x, y, z };
+	if (uploadNeeded(loc, v, sizeof(v)))
+		glUniform3fv(loc, 1, v);
 }
 
 //-----------------------------------------------------------------------------
@@ -231,13 +276,16 @@ void Shader :: setUniform(const string& name, float x, float y, float z)
 void Shader :: setUniform(const string& name, const glm::vec4& v)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform4fv(loc, 1, &v[0]);
+	if (uploadNeeded(loc, &v[0], sizeof(v)))
+		glUniform4fv(loc, 1, &v[0]);
 }
 
 void Shader :: setUniform(const string& name, float x, float y, float z, float w)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniform4f(loc, x, y, z, w);
+	const GLfloat v[4] = { x, y, z, w };
+	if (uploadNeeded(loc, v, sizeof(v)))
+		glUniform4fv(loc, 1, v);
 }
 
 //-----------------------------------------------------------------------------
@@ -246,7 +294,8 @@ void Shader :: setUniform(const string& name, float x, float y, float z, float w
 void Shader :: setUniform(const string& name, const glm::mat2& m)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniformMatrix2fv(loc, 1, GL_FALSE, &m[0][0]);
+	if (uploadNeeded(loc, &m[0][0], sizeof(m)))
+		glUniformMatrix2fv(loc, 1, GL_FALSE, &m[0][0]);
 }
 
 //-----------------------------------------------------------------------------
@@ -255,7 +304,8 @@ void Shader :: setUniform(const string& name, const glm::mat2& m)
 void Shader :: setUniform(const string& name, const glm::mat3& m)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
+	if (uploadNeeded(loc, &m[0][0], sizeof(m)))
+		glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
 }
 
 //-----------------------------------------------------------------------------
@@ -264,7 +314,237 @@ void Shader :: setUniform(const string& name, const glm::mat3& m)
 void Shader :: setUniform(const string& name, const glm::mat4& m)
 {
 	GLint loc = getUniformLocation(name.c_str());
-	glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+	if (uploadNeeded(loc, &m[0][0], sizeof(m)))
+		glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+
+//-----------------------------------------------------------------------------
+// Sets a glm::mat4 array shader uniform, name without the subscript
+//-----------------------------------------------------------------------------
+void Shader :: setUniform(const string& name, const glm::mat4 * m, GLsizei count)
+{
+	GLint loc = getUniformLocation(name.c_str());
+	uploadArray(loc, count);
+	glUniformMatrix4fv(loc, count, GL_FALSE, &m[0][0][0]);
+}
+
+//-----------------------------------------------------------------------------
+// Builds the uniform table of the linked program
+//-----------------------------------------------------------------------------
+void Shader :: reflectUniforms()
+{
+	mUniforms.clear();
+	mUniformIndex.clear();
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(mHandle, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(mHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<GLchar> buffer(maxLength + 1);
+
+	for (GLint i = 0; i < count; i++) {
+		ShaderUniform uniform;
+		GLsizei length = 0;
+		glGetActiveUniform(mHandle, (GLuint) i, (GLsizei) buffer.size(), &length,
+			&uniform.size, &uniform.type, buffer.data());
+		uniform.name.assign(buffer.data(), length);
+		uniform.location = glGetUniformLocation(mHandle, uniform.name.c_str());
+
+		// Arrays of basic types are reported once, as "name[0]"
+		const string suffix = "[0]";
+		if (uniform.name.size() > suffix.size() &&
+			uniform.name.compare(uniform.name.size() - suffix.size(), suffix.size(), suffix) == 0)
+			uniform.name.resize(uniform.name.size() - suffix.size());
+
+		mUniformIndex[uniform.name] = (UniformHandle) mUniforms.size();
+		mUniforms.push_back(uniform);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Resolves a uniform name to a handle, -1 if the program has no such uniform
+//-----------------------------------------------------------------------------
+UniformHandle Shader :: uniformHandle(const string& name)
+{
+	std::unordered_map<string, UniformHandle>::iterator it = mUniformIndex.find(name);
+	if (it != mUniformIndex.end())
+		return it->second;
+
+	// An element of an array: "[0]" is the array itself, others get an entry
+	// of their own covering the rest of the array
+	size_t open = name.rfind('[');
+	if (open == string::npos || name[name.size() - 1] != ']')
+		return -1;
+	it = mUniformIndex.find(name.substr(0, open));
+	if (it == mUniformIndex.end())
+		return -1;
+	GLint element = std::atoi(name.c_str() + open + 1);
+	if (element == 0)
+		return it->second;
+
+	ShaderUniform uniform = mUniforms[it->second];
+	if (element < 0 || element >= uniform.size)
+		return -1;
+	uniform.name = name;
+	uniform.location = glGetUniformLocation(mHandle, name.c_str());
+	uniform.size -= element;
+
+	UniformHandle handle = (UniformHandle) mUniforms.size();
+	mUniformIndex[name] = handle;
+	mUniforms.push_back(uniform);
+	return handle;
+}
+
+const std::vector<ShaderUniform>& Shader :: uniforms() const
+{
+	return mUniforms;
+}
+
+const ShaderUniform * Shader :: uniformAt(UniformHandle u) const
+{
+	if (u < 0 || u >= (UniformHandle) mUniforms.size())
+		return NULL;
+	return &mUniforms[u];
+}
+
+//-----------------------------------------------------------------------------
+// Setters through handles, no-ops for -1 like glUniform for location -1
+//-----------------------------------------------------------------------------
+void Shader :: setUniform(UniformHandle u, bool value)
+{
+	int v = (int) value;
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &v, sizeof(v)))
+		glUniform1i(uniform->location, v);
+}
+
+void Shader :: setUniform(UniformHandle u, int value)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &value, sizeof(value)))
+		glUniform1i(uniform->location, value);
+}
+
+void Shader :: setUniform(UniformHandle u, float value)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &value, sizeof(value)))
+		glUniform1f(uniform->location, value);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::vec2& v)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &v[0], sizeof(v)))
+		glUniform2fv(uniform->location, 1, &v[0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::vec3& v)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &v[0], sizeof(v)))
+		glUniform3fv(uniform->location, 1, &v[0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::vec4& v)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &v[0], sizeof(v)))
+		glUniform4fv(uniform->location, 1, &v[0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::mat3& m)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &m[0][0], sizeof(m)))
+		glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &m[0][0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::mat4& m)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (uniform && uploadNeeded(uniform->location, &m[0][0], sizeof(m)))
+		glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &m[0][0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const float * v, GLsizei count)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (!uniform)
+		return;
+	count = std::min(count, (GLsizei) uniform->size);
+	uploadArray(uniform->location, count);
+	glUniform1fv(uniform->location, count, v);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::vec3 * v, GLsizei count)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (!uniform)
+		return;
+	count = std::min(count, (GLsizei) uniform->size);
+	uploadArray(uniform->location, count);
+	glUniform3fv(uniform->location, count, &v[0][0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::vec4 * v, GLsizei count)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (!uniform)
+		return;
+	count = std::min(count, (GLsizei) uniform->size);
+	uploadArray(uniform->location, count);
+	glUniform4fv(uniform->location, count, &v[0][0]);
+}
+
+void Shader :: setUniform(UniformHandle u, const glm::mat4 * m, GLsizei count)
+{
+	const ShaderUniform * uniform = uniformAt(u);
+	if (!uniform)
+		return;
+	count = std::min(count, (GLsizei) uniform->size);
+	uploadArray(uniform->location, count);
+	glUniformMatrix4fv(uniform->location, count, GL_FALSE, &m[0][0][0]);
+}
+
+//-----------------------------------------------------------------------------
+// Shadow state: whether a value must be sent to a location, remembering it
+// when so. Locations are small dense integers in practice, far ones and values
+// larger than a mat4 are always sent.
+//-----------------------------------------------------------------------------
+bool Shader :: uploadNeeded(GLint location, const void * value, size_t bytes)
+{
+	if (location < 0)
+		return false;
+
+#ifdef SHADER_UNIFORM_SHADOW
+	if (location < MAX_SHADOW_LOCATIONS && bytes <= sizeof(UniformShadow::value)) {
+		if ((size_t) location >= mShadow.size())
+			mShadow.resize(location + 1);
+		UniformShadow & shadow = mShadow[location];
+		if (shadow.bytes == bytes && std::memcmp(shadow.value, value, bytes) == 0) {
+			uniformStats.skipped++;
+			return false;
+		}
+		shadow.bytes = (GLuint) bytes;
+		std::memcpy(shadow.value, value, bytes);
+	}
+#endif
+
+	uniformStats.issued++;
+	return true;
+}
+
+// Arrays are always sent; element locations they may cover lose their shadow
+void Shader :: uploadArray(GLint location, GLsizei count)
+{
+	if (location < 0)
+		return;
+	uniformStats.issued++;
+
+#ifdef SHADER_UNIFORM_SHADOW
+	for (GLint i = location; i < location + count && (size_t) i < mShadow.size(); i++)
+		mShadow[i].bytes = 0;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -3,8 +3,41 @@
 
 #include <string>
 #include <map>
+#include <vector>
+#include <unordered_map>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <Handle.h>
+
+/**
+* Every setter compares the value with a CPU shadow of the last one sent to
+* that location and skips the glUniform call when they are bitwise equal.
+* Build with -DSHADER_NO_UNIFORM_SHADOW to send everything, e.g. for profiling.
+* Uniforms set outside Shader (raw glUniform) are not seen by the shadow.
+*/
+#ifndef SHADER_NO_UNIFORM_SHADOW
+#define SHADER_UNIFORM_SHADOW
+#endif
+
+/** Upload counters of all programs, reset by the application once per frame */
+struct UniformStats {
+	size_t issued;  // glUniform calls made
+	size_t skipped; // values equal to the shadow
+};
+
+UniformStats GetUniformStats();
+void ResetUniformStats();
+
+// Index into the uniform table of one linked program, -1: not an active uniform
+typedef GLint UniformHandle;
+
+// An active uniform found by glGetActiveUniform at link time
+struct ShaderUniform {
+	std::string name; // arrays without the "[0]" suffix
+	GLint location;
+	GLenum type;      // e.g. GL_FLOAT_MAT4
+	GLint size;       // array length, 1 otherwise
+};
 
 class Shader {
 
@@ -30,6 +63,9 @@ public:
 
 	GLuint ID() const;
 
+	// Generational handle of the linked program, stale once the Shader is gone
+	ProgramHandle Handle() const;
+
 	bool loadShaders(
 		const char* vsFilename,
 		const char* fsFilename,
@@ -47,6 +83,27 @@ public:
 	void setUniform(const std::string& name, const glm::mat2& m);
 	void setUniform(const std::string& name, const glm::mat3& m);
 	void setUniform(const std::string& name, const glm::mat4& m);
+	void setUniform(const std::string& name, const glm::mat4 * m, GLsizei count); // array
+
+	// Reflection: resolve handles once after loadShaders, set through them every
+	// frame without building strings. Names are those of the table, or array
+	// elements ("uLights[2]"); handles go stale when the program is reloaded.
+	UniformHandle uniformHandle(const std::string& name);
+	const std::vector<ShaderUniform>& uniforms() const;
+
+	void setUniform(UniformHandle u, bool value);
+	void setUniform(UniformHandle u, int value);
+	void setUniform(UniformHandle u, float value);
+	void setUniform(UniformHandle u, const glm::vec2& v);
+	void setUniform(UniformHandle u, const glm::vec3& v);
+	void setUniform(UniformHandle u, const glm::vec4& v);
+	void setUniform(UniformHandle u, const glm::mat3& m);
+	void setUniform(UniformHandle u, const glm::mat4& m);
+	// Whole arrays in one call, count is clamped to the array size
+	void setUniform(UniformHandle u, const float * v, GLsizei count);
+	void setUniform(UniformHandle u, const glm::vec3 * v, GLsizei count);
+	void setUniform(UniformHandle u, const glm::vec4 * v, GLsizei count);
+	void setUniform(UniformHandle u, const glm::mat4 * m, GLsizei count);
 
 private:
 
@@ -55,9 +112,30 @@ private:
 	void  checkCompileErrors(GLuint shader, ShaderType type);
 
 	GLint getUniformLocation(const GLchar * name);
+
+	void reflectUniforms();
+	const ShaderUniform * uniformAt(UniformHandle u) const;
+	bool uploadNeeded(GLint location, const void * value, size_t bytes);
+	void uploadArray(GLint location, GLsizei count);
+
+	/** Last value sent to a location, bytes 0 when unknown */
+	struct UniformShadow {
+		GLuint bytes;
+		unsigned char value[sizeof(glm::mat4)];
+
+		UniformShadow() : bytes(0) {}
+	};
+	static const GLint MAX_SHADOW_LOCATIONS = 4096;
 	
 	GLuint mHandle;
+	ProgramHandle mProgram;
 	std::map<std::string, GLint> mUniformLocations;
+	std::vector<ShaderUniform> mUniforms;
+	std::unordered_map<std::string, UniformHandle> mUniformIndex;
+	std::vector<UniformShadow> mShadow; // by location
 };
 
+// GL name of a live program, 0 for stale handles
+GLuint ProgramId(ProgramHandle handle);
+
 #endif // SHADER_H
@@ -0,0 +1,48 @@
+#include <StringTable.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Function statics, so globals of other files can intern during static initialization
+struct InternTable {
+	std::mutex mutex;
+	std::deque<std::string> strings; // never moves its elements on push_back
+	std::unordered_map<std::string, StringId> ids;
+
+	InternTable() { strings.push_back(std::string()); }
+};
+
+static InternTable & Table() {
+	static InternTable table;
+	return table;
+}
+
+StringId InternString(const std::string & text) {
+
+	if (text.empty()) return 0;
+
+	InternTable & table = Table();
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	std::unordered_map<std::string, StringId>::iterator it = table.ids.find(text);
+	if (it != table.ids.end()) return it->second;
+
+	StringId id = (StringId) table.strings.size();
+	table.strings.push_back(text);
+	table.ids[text] = id;
+	return id;
+}
+
+const std::string & InternedString(StringId id) {
+	InternTable & table = Table();
+	std::lock_guard<std::mutex> lock(table.mutex);
+	return id < table.strings.size() ? table.strings[id] : table.strings[0];
+}
+
+size_t InternedStringCount() {
+	InternTable & table = Table();
+	std::lock_guard<std::mutex> lock(table.mutex);
+	return table.strings.size() - 1;
+}
@@ -0,0 +1,22 @@
+#ifndef STRINGTABLE_H
+#define STRINGTABLE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+* Process-wide interned strings, e.g. texture paths: every distinct string is
+* stored once and referred to by a 32-bit id, so records holding one stay small
+* and compare paths by id. Strings live until exit. Thread safe.
+*/
+
+typedef uint32_t StringId; // 0 is the empty string
+
+/** Methods */
+
+StringId InternString(const std::string & text);
+const std::string & InternedString(StringId id); // stays valid, "" for unknown ids
+size_t InternedStringCount();
+
+#endif
@@ -1,4 +1,10 @@
 #include <Texture.h>
+#include <ThreadPool.h>
+#include <LockFreeQueue.h>
+#include <Hash.h>
+#include <TextureCompress.h>
+#include <UploadRing.h>
+#include <StringTable.h>
 
 /** Only include this once */
 #define STB_IMAGE_IMPLEMENTATION
@@ -7,10 +13,16 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <memory>
 
 std::unordered_map<TextureType, std::string> TextureTypeName = {
 	std::pair<TextureType, std::string> (TEX_UNKNOWN,  "texture_unknown"),
@@ -22,45 +34,739 @@ std::unordered_map<TextureType, std::string> TextureTypeName = {
 	std::pair<TextureType, std::string> (TEX_AMBIENT,  "texture_ambient")
 };
 
+/** Texture handles */
+
+static SlotArray<unsigned int, TextureTag> textureHandles;
+static std::unordered_map<unsigned int, TextureHandle> handleById;
+
+TextureHandle TextureHandleFor(unsigned int id) {
+	if (id == 0) return TextureHandle();
+	std::unordered_map<unsigned int, TextureHandle>::iterator it = handleById.find(id);
+	if (it != handleById.end()) return it->second;
+	TextureHandle handle = textureHandles.Insert(id);
+	handleById[id] = handle;
+	return handle;
+}
+
+unsigned int TextureId(TextureHandle handle) {
+	const unsigned int * id = textureHandles.Get(handle);
+	return id ? *id : 0;
+}
+
+static void ForgetTextureHandle(unsigned int id) {
+	std::unordered_map<unsigned int, TextureHandle>::iterator it = handleById.find(id);
+	if (it == handleById.end()) return;
+	textureHandles.Remove(it->second);
+	handleById.erase(it);
+}
+
+// Bytes of every uploaded texture, mip chain included
+static std::unordered_map<unsigned int, size_t> textureBytes;
+static size_t residentBytes = 0;
+static size_t peakBytes = 0;
+
+size_t TextureBytes(unsigned int id) {
+	std::unordered_map<unsigned int, size_t>::const_iterator it = textureBytes.find(id);
+	return it != textureBytes.end() ? it->second : 0;
+}
+
+// 0 forgets the texture
+static void SetTextureBytes(unsigned int id, size_t bytes) {
+	residentBytes -= TextureBytes(id);
+	residentBytes += bytes;
+	peakBytes = std::max(peakBytes, residentBytes);
+	if (bytes) textureBytes[id] = bytes;
+	else textureBytes.erase(id);
+}
+
+void TrackTextureBytes(unsigned int id, size_t bytes) {
+	SetTextureBytes(id, bytes);
+}
+
+/** Residency */
+
+// Evicted textures keep the levels of at most this many texels per side
+static const int RESIDENT_MIP_SIZE = 64;
+
+// The low-mip placeholder of every texture larger than that, kept on the CPU
+// so eviction needs neither a read back nor a file
+static std::unordered_map<unsigned int, TextureImage> lowMips;
+
+static int LevelSize(int size, size_t level) {
+	return std::max(size >> level, 1);
+}
+
+// First level of the tail of at most RESIDENT_MIP_SIZE texels per side
+static size_t TailLevel(const TextureImage & image) {
+	size_t first = 0;
+	while (std::max(LevelSize(image.width, first), LevelSize(image.height, first)) > RESIDENT_MIP_SIZE
+		&& first + 1 < image.levelSizes.size())
+		first++;
+	return first;
+}
+
+static void KeepLowMips(unsigned int id, const TextureImage & image) {
+
+	size_t first = TailLevel(image);
+	if (first == 0) return; // the whole chain is that small already
+
+	TextureImage & low = lowMips[id];
+	low.type = image.type;
+	low.internalFormat = image.internalFormat;
+	low.baseFormat = image.baseFormat;
+	low.width = LevelSize(image.width, first);
+	low.height = LevelSize(image.height, first);
+	low.levelOffsets.clear();
+	low.levelSizes.clear();
+	low.data.clear();
+	for (size_t level=first; level<image.levelSizes.size(); level++) {
+		const unsigned char * data = &image.data[image.levelOffsets[level]];
+		low.levelOffsets.push_back(low.data.size());
+		low.levelSizes.push_back(image.levelSizes[level]);
+		low.data.insert(low.data.end(), data, data + image.levelSizes[level]);
+	}
+}
+
+static void EnforceTextureBudget();
+
+/** Encoding */
+
+static bool textureCompression = true;
+
+void SetTextureCompression(bool enabled) {
+	textureCompression = enabled;
+}
+
+// GL thread. BC4/BC5 are core, BC1/BC3 need S3TC which every desktop driver exposes,
+// and their sRGB variants (gamma textures) EXT_texture_sRGB as well; without them
+// textures still get CPU mips, as 8-bit levels
+static bool CompressionEnabled(bool gamma) {
+	static int s3tc = -1, srgb = -1;
+	if (s3tc < 0) {
+		s3tc = srgb = 0;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i=0; i<count; i++) {
+			const char * name = (const char *) glGetStringi(GL_EXTENSIONS, (GLuint) i);
+			if (!name) continue;
+			if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) s3tc = 1;
+			if (std::strcmp(name, "GL_EXT_texture_sRGB") == 0) srgb = 1;
+		}
+	}
+	return textureCompression && s3tc == 1 && (!gamma || srgb == 1);
+}
+
+// Levels [first, last) of the chain, copied through the upload ring. Sampling
+// is unchanged until ShowLevels moves the base level onto them.
+static size_t UploadLevels(unsigned int textureID, const TextureImage & image, size_t first, size_t last) {
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// Every level comes from the encoder or its cache, no glGenerateMipmap.
+	// Uncompressed rows are padded to 4 bytes, the default unpack alignment.
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	size_t bytes = 0;
+	for (size_t level=first; level<last; level++) {
+		const void * data = StageTextureData(&image.data[image.levelOffsets[level]], image.levelSizes[level]);
+		int width = LevelSize(image.width, level), height = LevelSize(image.height, level);
+		if (image.type == 0)
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint) level, image.internalFormat, width, height, 0,
+				(GLsizei) image.levelSizes[level], data);
+		else
+			glTexImage2D(GL_TEXTURE_2D, (GLint) level, image.internalFormat, width, height, 0,
+				image.baseFormat, image.type, data);
+		bytes += image.levelSizes[level];
+	}
+	EndTextureStaging();
+
+	return bytes;
+}
+
+// Sample levels first and up. Levels below first may hold an older image,
+// they are outside the base level range and ignored until overwritten
+// (UploadStep keeps it so for evicted textures, which show their low chain
+// from level 0).
+static void ShowLevels(unsigned int textureID, size_t first, size_t numLevels) {
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint) first);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint) numLevels - 1);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Shown at once, GL orders the copies before any draw that samples them
+static void UploadTextureImage(unsigned int textureID, const TextureImage & image) {
+	SetTextureBytes(textureID, UploadLevels(textureID, image, 0, image.levelSizes.size()));
+	ShowLevels(textureID, 0, image.levelSizes.size());
+	KeepLowMips(textureID, image);
+}
+
+// Any thread: the KTX cache of an image, encoded with its mips and written on a miss
+static bool PrepareImage(const std::string & filename, const std::vector<unsigned char> & bytes,
+	bool gamma, bool normalMap, bool blockCompress, TextureImage & image) {
+
+	uint64_t key = TextureCacheKey(bytes.data(), bytes.size(), gamma, normalMap, blockCompress);
+	std::string cachePath = TextureCachePath(filename, gamma, normalMap, blockCompress);
+	if (ReadKtx(cachePath, key, image)) return true;
+
+	int width, height, nrComponents;
+	unsigned char * data = stbi_load_from_memory(bytes.data(), (int) bytes.size(),
+		&width, &height, &nrComponents, 0);
+	if (!data) return false;
+
+	EncodeImage(data, width, height, nrComponents, gamma, normalMap, blockCompress, image);
+	stbi_image_free(data);
+
+	if (!WriteKtx(cachePath, key, image))
+		std::cerr << "PrepareImage: cannot write " << cachePath << "\n";
+	return true;
+}
+
+bool LoadTextureImage(const std::string & filename, const std::vector<unsigned char> & bytes,
+	bool gamma, TextureType type, TextureImage & image) {
+	bool normalMap = type == TEX_NORMAL;
+	return PrepareImage(filename, bytes, gamma, normalMap, CompressionEnabled(gamma && !normalMap), image);
+}
+
+static bool ReadFileBytes(const std::string & filename, std::vector<unsigned char> & bytes) {
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+
+	std::streamsize length = file.tellg();
+	if (length <= 0) return false;
+	file.seekg(0, std::ios::beg);
+
+	bytes.resize((size_t) length);
+	return (bool) file.read((char *) bytes.data(), length);
+}
+
+// GL thread, reads the cache (or encodes) and uploads at once
+static unsigned int LoadImageNow(const std::string & filename, const std::vector<unsigned char> & bytes,
+	bool gamma, bool normalMap) {
+
+	unsigned int textureID{};
+	TextureImage image;
+	if (PrepareImage(filename, bytes, gamma, normalMap, CompressionEnabled(gamma && !normalMap), image)) {
+		glGenTextures(1, &textureID);
+		UploadTextureImage(textureID, image);
+	}
+	return textureID;
+}
+
 unsigned int LoadTexture(const std::string filename, bool gamma) {
 
 	unsigned int textureID{};
-	int width, height, nrComponents;
-	unsigned char * data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+	std::vector<unsigned char> bytes;
+	if (ReadFileBytes(filename, bytes))
+		textureID = LoadImageNow(filename, bytes, gamma, false);
 
-	if (!data)
+	if (textureID == 0)
 		std::cerr << "LoadTexture: Texture failed to load at path: " << filename << "\n";
 
-	else {
-		GLenum imageFormat;
-		GLenum dataFormat;
-		if (nrComponents == 1) {
-			imageFormat = GL_RED;
-			dataFormat = GL_RED;
-		} else if (nrComponents == 3) {
-			imageFormat = gamma ? GL_SRGB : GL_RGB;
-			dataFormat = GL_RGB;
-		} else if (nrComponents == 4) {
-			imageFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
-			dataFormat = GL_RGBA;
+	return textureID;
+}
+
+/** Asynchronous loading */
+
+struct DecodedImage {
+	unsigned int id;
+	unsigned int ticket;
+	std::string filename;
+	bool loaded;
+	TextureImage image;
+	size_t firstUploaded; // finest level sent, levelSizes.size() before the first upload
+	size_t firstShown;    // finest level sampled, once the copies are complete
+	uint64_t serial;      // UploadSerial after the last step
+};
+
+// Declared before the pool so it outlives the workers at exit
+static LockFreeQueue<DecodedImage *> decodedImages;
+// GL thread: decoded images whose chain is still going up, coarse levels first
+static std::vector<DecodedImage *> streamingImages;
+static size_t uploadBudget = 0;  // bytes per frame, 0: unlimited
+static size_t uploadedBytes = 0; // since ResetTextureUploads
+static std::unique_ptr<ThreadPool> decodePool;
+static unsigned int decodeThreads = 0;
+static unsigned int pendingImages = 0;
+
+// Texture id -> ticket of its decode job. A texture deleted while decoding drops
+// its ticket, so a late result is never uploaded into a recycled texture name.
+static std::unordered_map<unsigned int, unsigned int> pendingTickets;
+static unsigned int nextTicket = 1;
+
+static ThreadPool & DecodePool() {
+	if (!decodePool)
+		decodePool.reset(new ThreadPool(decodeThreads));
+	return *decodePool;
+}
+
+void SetTextureThreads(unsigned int numThreads) {
+	if (decodePool) decodePool->Wait();
+	decodeThreads = numThreads;
+	decodePool.reset(new ThreadPool(decodeThreads));
+}
+
+// Decode into an existing texture, which keeps what it shows until the upload
+static void QueueDecode(unsigned int textureID, const std::string & filename,
+	std::shared_ptr<std::vector<unsigned char> > bytes, bool gamma, bool normalMap) {
+
+	unsigned int ticket = nextTicket++;
+	pendingTickets[textureID] = ticket;
+	pendingImages++;
+
+	// Mip building and compression run here too, one image per worker
+	bool compress = CompressionEnabled(gamma && !normalMap);
+
+	DecodePool().Submit([textureID, ticket, filename, bytes, gamma, normalMap, compress] {
+		DecodedImage * image = new DecodedImage;
+		image->id = textureID;
+		image->ticket = ticket;
+		image->filename = filename;
+		image->loaded = false;
+
+		std::shared_ptr<std::vector<unsigned char> > source = bytes;
+		if (!source) {
+			source = std::make_shared<std::vector<unsigned char> >();
+			if (!ReadFileBytes(filename, *source)) source->clear();
 		}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, imageFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (!source->empty())
+			image->loaded = PrepareImage(filename, *source, gamma, normalMap, compress, image->image);
+		decodedImages.Push(image);
+	});
+}
+
+static unsigned int SubmitDecode(const std::string & filename,
+	std::shared_ptr<std::vector<unsigned char> > bytes, bool gamma, bool normalMap) {
+
+	unsigned int textureID{};
+	glGenTextures(1, &textureID);
+
+	// 1x1 placeholder so the texture is complete until the real image arrives
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	SetTextureBytes(textureID, sizeof(white));
+
+	QueueDecode(textureID, filename, bytes, gamma, normalMap);
+	return textureID;
+}
+
+unsigned int LoadTextureAsync(const std::string filename, bool gamma) {
+	return SubmitDecode(filename, NULL, gamma, false);
+}
+
+// Still the image the texture waits for, not cancelled or replaced by a newer decode
+static bool IsLiveImage(const DecodedImage * image) {
+	std::unordered_map<unsigned int, unsigned int>::const_iterator it = pendingTickets.find(image->id);
+	return it != pendingTickets.end() && it->second == image->ticket;
+}
+
+static void FinishImage(DecodedImage * image) {
+	if (IsLiveImage(image)) pendingTickets.erase(image->id);
+	delete image;
+	pendingImages--;
+}
+
+// Bytes the next upload step of a streaming image sends: the whole low-mip
+// tail first, then one finer level at a time
+static size_t NextStepBytes(const DecodedImage * image) {
+	const std::vector<size_t> & sizes = image->image.levelSizes;
+	size_t first = image->firstUploaded == sizes.size() ? TailLevel(image->image) : image->firstUploaded - 1;
+	size_t bytes = 0;
+	for (size_t level=first; level<image->firstUploaded; level++)
+		bytes += sizes[level];
+	return bytes;
+}
+
+static void UploadStep(DecodedImage * image) {
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	const TextureImage & chain = image->image;
+	size_t count = chain.levelSizes.size();
+	size_t first = image->firstUploaded == count ? TailLevel(chain) : image->firstUploaded - 1;
+
+	// An evicted texture shows its low chain as levels 0 and up, which the tail
+	// overwrites with other sizes at the full chain's numbering. The tail is the
+	// same image, so it is shown at once rather than after its fence: the
+	// texture never samples a mix of both, and every later step lands below it.
+	bool restream = image->firstUploaded == count && lowMips.count(image->id) > 0;
+
+	UploadLevels(image->id, chain, first, image->firstUploaded);
+	if (image->firstUploaded == count) KeepLowMips(image->id, chain);
+	image->firstUploaded = first;
+	image->serial = UploadSerial();
+	if (restream) {
+		ShowLevels(image->id, first, count);
+		image->firstShown = first;
 	}
 
-	stbi_image_free(data);
+	size_t bytes = 0;
+	for (size_t level=first; level<count; level++)
+		bytes += chain.levelSizes[level];
+	SetTextureBytes(image->id, bytes);
+}
+
+// limited: stop at the per-frame budget, though every frame makes one step so
+// a level larger than the budget still goes up
+static unsigned int UploadStreaming(bool limited) {
+
+	DecodedImage * image;
+	while (decodedImages.Pop(image)) {
+		if (!image->loaded) {
+			std::cerr << "LoadTextureAsync: Texture failed to load at path: " << image->filename << "\n";
+			FinishImage(image);
+		} else {
+			image->firstUploaded = image->firstShown = image->image.levelSizes.size();
+			image->serial = 0;
+			streamingImages.push_back(image);
+		}
+	}
+
+	if (streamingImages.empty()) return 0;
+
+	// Keep the caller's binding on the active unit intact
+	GLint boundTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+	bool stepped = false;
+	for (;;) {
+		// Drop textures deleted meanwhile, then take the cheapest step: every
+		// texture gets its tail before any gets detail, and detail goes up
+		// coarse to fine across all of them
+		size_t next = streamingImages.size();
+		for (size_t i=0; i<streamingImages.size(); ) {
+			if (!IsLiveImage(streamingImages[i])) {
+				FinishImage(streamingImages[i]);
+				streamingImages[i] = streamingImages.back();
+				streamingImages.pop_back();
+				continue;
+			}
+			if (streamingImages[i]->firstUploaded > 0 && (next == streamingImages.size()
+				|| NextStepBytes(streamingImages[i]) < NextStepBytes(streamingImages[next])))
+				next = i;
+			i++;
+		}
+		if (next == streamingImages.size()) break;
+
+		image = streamingImages[next];
+		size_t bytes = NextStepBytes(image);
+		if (limited && uploadBudget && uploadedBytes > 0 && uploadedBytes + bytes > uploadBudget) break;
+
+		UploadStep(image);
+		uploadedBytes += bytes;
+		stepped = true;
+	}
+
+	// Draws switch to new levels only once their copies are done, so they never
+	// wait on a transfer. FinishTextures shows them at once.
+	unsigned int uploaded = 0;
+	for (size_t i=0; i<streamingImages.size(); ) {
+		image = streamingImages[i];
+		if (image->firstShown != image->firstUploaded && (!limited || UploadsComplete(image->serial))) {
+			ShowLevels(image->id, image->firstUploaded, image->image.levelSizes.size());
+			image->firstShown = image->firstUploaded;
+		}
+		if (image->firstShown == 0) {
+			streamingImages[i] = streamingImages.back();
+			streamingImages.pop_back();
+			FinishImage(image);
+			uploaded++;
+			continue;
+		}
+		i++;
+	}
+
+	if (stepped) EnforceTextureBudget();
+	glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+
+	return uploaded;
+}
+
+unsigned int UploadTextures() {
+	return UploadStreaming(true);
+}
+
+void SetTextureUploadBudget(size_t bytes) {
+	uploadBudget = bytes;
+}
+
+void ResetTextureUploads() {
+	uploadedBytes = 0;
+}
+
+unsigned int PendingTextures() {
+	return pendingImages;
+}
+
+void FinishTextures() {
+	if (decodePool) decodePool->Wait();
+	UploadStreaming(false);
+}
+
+/** Texture registry */
+
+struct TextureEntry {
+	unsigned int refs;
+	unsigned int hits;
+	uint64_t hashKey;
+	uint64_t fileSize;
+	std::vector<std::string> pathKeys; // every path this texture was requested by
+	// Residency
+	std::string filename; // to stream the full chain back in
+	bool gamma;
+	bool normalMap;
+	bool evicted;
+	uint64_t lastUse;     // useClock of the last BindTexture
+};
+
+static std::unordered_map<std::string, unsigned int> registryByPath; // canonical path -> id
+static std::unordered_map<uint64_t, unsigned int> registryByHash;    // content hash -> id
+static std::unordered_map<unsigned int, TextureEntry> registry;      // id -> entry
+static TextureCacheStats registryStats = {};
+static size_t releasedBytesSaved = 0;
+
+static std::string CanonicalPath(const std::string & filename) {
+#ifdef _WIN32
+	char resolved[_MAX_PATH];
+	if (_fullpath(resolved, filename.c_str(), _MAX_PATH)) return resolved;
+#else
+	char resolved[PATH_MAX];
+	if (realpath(filename.c_str(), resolved)) return resolved;
+#endif
+	return filename;
+}
+
+// A hash hit is only a candidate: the file must also match in length and bytes
+static bool SameFileContent(const TextureEntry & entry, const std::vector<unsigned char> & bytes) {
+	if (entry.fileSize != bytes.size()) return false;
+	std::vector<unsigned char> other;
+	return ReadFileBytes(entry.filename, other) && other == bytes;
+}
+
+static void DeleteTexture(unsigned int id) {
+	pendingTickets.erase(id); // cancel a decode still in flight
+	SetTextureBytes(id, 0);
+	lowMips.erase(id);
+	ForgetTextureHandle(id);
+	glDeleteTextures(1, &id);
+}
+
+unsigned int AcquireTexture(const std::string filename, bool gamma, bool async, TextureType type) {
+
+	// sRGB and linear uploads of one file are different textures, and so are
+	// normal maps, which compress to two channels
+	bool normalMap = type == TEX_NORMAL;
+	std::string pathKey = CanonicalPath(filename) + (gamma ? "#srgb" : "#linear") + (normalMap ? "#normal" : "");
+
+	std::unordered_map<std::string, unsigned int>::iterator byPath = registryByPath.find(pathKey);
+	if (byPath != registryByPath.end()) {
+		TextureEntry & entry = registry[byPath->second];
+		entry.refs++;
+		entry.hits++;
+		registryStats.hits++;
+		return byPath->second;
+	}
+
+	std::shared_ptr<std::vector<unsigned char> > bytes = std::make_shared<std::vector<unsigned char> >();
+	if (!ReadFileBytes(filename, *bytes)) {
+		std::cerr << "AcquireTexture: Texture failed to load at path: " << filename << "\n";
+		return 0;
+	}
+
+	// Same content under another path (e.g. nanosuit and nanosuit_reflection)
+	uint64_t hashKey = HashBytes(bytes->data(), bytes->size(), (gamma ? 1 : 0) | (normalMap ? 2 : 0));
+	std::unordered_map<uint64_t, unsigned int>::iterator byHash = registryByHash.find(hashKey);
+	if (byHash != registryByHash.end() && SameFileContent(registry[byHash->second], *bytes)) {
+		TextureEntry & entry = registry[byHash->second];
+		entry.refs++;
+		entry.hits++;
+		entry.pathKeys.push_back(pathKey);
+		registryByPath[pathKey] = byHash->second;
+		registryStats.hits++;
+		return byHash->second;
+	}
+
+	unsigned int textureID{};
+	if (async)
+		textureID = SubmitDecode(filename, bytes, gamma, normalMap);
+	else {
+		textureID = LoadImageNow(filename, *bytes, gamma, normalMap);
+		if (textureID == 0)
+			std::cerr << "AcquireTexture: Texture failed to load at path: " << filename << "\n";
+	}
+	if (textureID == 0) return 0;
+
+	TextureEntry & entry = registry[textureID];
+	entry.refs = 1;
+	entry.hits = 0;
+	entry.hashKey = hashKey;
+	entry.fileSize = bytes->size();
+	entry.pathKeys.push_back(pathKey);
+	entry.filename = filename;
+	entry.gamma = gamma;
+	entry.normalMap = normalMap;
+	entry.evicted = false;
+	entry.lastUse = 0;
+	registryByPath[pathKey] = textureID;
+	registryByHash.insert(std::make_pair(hashKey, textureID)); // a colliding file keeps the first's slot
+	registryStats.misses++;
+	if (!async) EnforceTextureBudget();
+
+	std::cout << "AcquireTexture: " << textureID << "\tfrom: " << filename << "\n";
 
 	return textureID;
 }
 
+void ReleaseTexture(unsigned int id) {
+
+	std::unordered_map<unsigned int, TextureEntry>::iterator it = registry.find(id);
+	if (it == registry.end()) return; // not owned by the registry
+
+	TextureEntry & entry = it->second;
+	if (--entry.refs > 0) return;
+
+	releasedBytesSaved += entry.hits * TextureBytes(id);
+	for (const std::string & pathKey : entry.pathKeys)
+		registryByPath.erase(pathKey);
+	std::unordered_map<uint64_t, unsigned int>::iterator byHash = registryByHash.find(entry.hashKey);
+	if (byHash != registryByHash.end() && byHash->second == id)
+		registryByHash.erase(byHash);
+	registry.erase(it);
+
+	DeleteTexture(id);
+}
+
+TextureRef :: TextureRef(TextureRef && other) noexcept : id(other.id) {
+	other.id = 0;
+}
+
+TextureRef & TextureRef :: operator=(TextureRef && other) noexcept {
+	if (this != &other) {
+		Reset();
+		id = other.id;
+		other.id = 0;
+	}
+	return *this;
+}
+
+TextureRef :: ~TextureRef() {
+	Reset();
+}
+
+void TextureRef :: Reset() {
+	if (id) ReleaseTexture(id);
+	id = 0;
+}
+
+TextureCacheStats GetTextureCacheStats() {
+
+	TextureCacheStats stats = registryStats;
+	stats.textures = (unsigned int) registry.size();
+	stats.bytes = 0;
+	stats.bytesSaved = releasedBytesSaved;
+
+	for (const std::pair<const unsigned int, TextureEntry> & item : registry) {
+		size_t bytes = TextureBytes(item.first);
+		stats.bytes += bytes;
+		stats.bytesSaved += item.second.hits * bytes;
+	}
+
+	return stats;
+}
+
+/** Residency */
+
+static size_t textureBudget = 0;
+static uint64_t useClock = 0;       // advances on every BindTexture
+static uint64_t enforcedClock = 0;  // useClock at the end of the last budget pass
+static unsigned int evictions = 0;
+static unsigned int restreams = 0;
+
+void SetTextureBudget(size_t bytes) {
+	textureBudget = bytes;
+	EnforceTextureBudget();
+}
+
+// Drop a texture to its low mips, the registry entry remembers how to restore it
+static bool EvictTexture(unsigned int id, TextureEntry & entry) {
+	std::unordered_map<unsigned int, TextureImage>::const_iterator low = lowMips.find(id);
+	if (low == lowMips.end() || entry.evicted || pendingTickets.count(id)) return false;
+
+	UploadTextureImage(id, low->second);
+	entry.evicted = true;
+	evictions++;
+	return true;
+}
+
+static void EnforceTextureBudget() {
+
+	if (textureBudget == 0 || residentBytes <= textureBudget) {
+		enforcedClock = useClock;
+		return;
+	}
+
+	// Least recently bound first. Textures bound since the last pass are in use
+	// by the frame being drawn and stay; the budget is exceeded until it ends.
+	std::vector<std::pair<uint64_t, unsigned int> > candidates;
+	for (const std::pair<const unsigned int, TextureEntry> & item : registry)
+		if (!item.second.evicted && item.second.lastUse <= enforcedClock && lowMips.count(item.first))
+			candidates.push_back(std::make_pair(item.second.lastUse, item.first));
+	std::sort(candidates.begin(), candidates.end());
+
+	GLint boundTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+	for (size_t i=0; i<candidates.size() && residentBytes > textureBudget; i++)
+		EvictTexture(candidates[i].second, registry[candidates[i].second]);
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint) boundTexture);
+	enforcedClock = useClock;
+}
+
+void BindTexture(unsigned int unit, unsigned int id) {
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D, id);
+
+	std::unordered_map<unsigned int, TextureEntry>::iterator it = registry.find(id);
+	if (it == registry.end()) return;
+
+	TextureEntry & entry = it->second;
+	entry.lastUse = ++useClock;
+
+	// The low mips stay bound until UploadTextures attaches the full chain
+	if (entry.evicted && !pendingTickets.count(id)) {
+		QueueDecode(id, entry.filename, NULL, entry.gamma, entry.normalMap);
+		entry.evicted = false;
+		restreams++;
+	}
+}
+
+void BindTexture(unsigned int unit, TextureHandle handle) {
+	BindTexture(unit, TextureId(handle));
+}
+
+TextureResidencyStats GetTextureResidencyStats() {
+
+	TextureResidencyStats stats;
+	stats.budget = textureBudget;
+	stats.current = residentBytes;
+	stats.peak = peakBytes;
+	stats.evictions = evictions;
+	stats.restreams = restreams;
+	stats.evicted = 0;
+	for (const std::pair<const unsigned int, TextureEntry> & item : registry)
+		if (item.second.evicted) stats.evicted++;
+	return stats;
+}
+
 unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 
 	/**
@@ -79,6 +785,7 @@ unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
 	int width, height, nrComponents;
+	size_t bytes = 0;
 
 	for (unsigned int i=0; i<faces.size(); i++) {
 
@@ -95,6 +802,7 @@ unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
 				0, imageFormat, width, height, 0, imageFormat, GL_UNSIGNED_BYTE, data);
+			bytes += (size_t) width * height * (nrComponents == 3 ? 4 : nrComponents); // RGB is padded
 		}
 
 		stbi_image_free(data);
@@ -106,6 +814,8 @@ unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+	SetTextureBytes(textureID, bytes);
+
 	return textureID;
 }
 
@@ -113,39 +823,43 @@ unsigned int LoadCubemap(const std::vector<std::string> & faces) {
 
 std::string defaultTextureFilename("Resources/default/default.png");
 
-Texture defaultDiffuseTexture  {0, TEX_DIFFUSE, defaultTextureFilename};
-Texture defaultSpecularTexture {0, TEX_SPECULAR, defaultTextureFilename};
+Texture defaultDiffuseTexture  {TextureHandle(), TEX_DIFFUSE, InternString(defaultTextureFilename)};
+Texture defaultSpecularTexture {TextureHandle(), TEX_SPECULAR, InternString(defaultTextureFilename)};
 /**
-Texture defaultNormalTexture   {0, TEX_NORMAL, defaultTextureFilename};
-Texture defaultHeightTexture   {0, TEX_HEIGHT, defaultTextureFilename};
-Texture defaultEmissionTexture {0, TEX_EMISSION, defaultTextureFilename};
+Texture defaultNormalTexture   {TextureHandle(), TEX_NORMAL, InternString(defaultTextureFilename)};
+Texture defaultHeightTexture   {TextureHandle(), TEX_HEIGHT, InternString(defaultTextureFilename)};
+Texture defaultEmissionTexture {TextureHandle(), TEX_EMISSION, InternString(defaultTextureFilename)};
 */
-Texture defaultUnknownTexture  {0, TEX_UNKNOWN, defaultTextureFilename};
+Texture defaultUnknownTexture  {TextureHandle(), TEX_UNKNOWN, InternString(defaultTextureFilename)};
 
 Texture DefaultTexture(TextureType type) {
 	if (type == defaultDiffuseTexture.type) {
-		if (defaultDiffuseTexture.id == 0)
-			defaultDiffuseTexture.id = LoadTexture(defaultDiffuseTexture.path);
+		if (defaultDiffuseTexture.handle.IsNull())
+			defaultDiffuseTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultDiffuseTexture;
 	} else if (type == defaultSpecularTexture.type) {
-		if (defaultSpecularTexture.id == 0)
-			defaultSpecularTexture.id = LoadTexture(defaultSpecularTexture.path);
+		if (defaultSpecularTexture.handle.IsNull())
+			defaultSpecularTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultSpecularTexture;
 	} /**else if (type == defaultNormalTexture.type) {
-		if (defaultNormalTexture.id == 0)
-			defaultNormalTexture.id = LoadTexture(defaultNormalTexture.path);
+		if (defaultNormalTexture.handle.IsNull())
+			defaultNormalTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultNormalTexture;
 	} else if (type == defaultHeightTexture.type) {
-		if (defaultHeightTexture.id == 0)
-			defaultHeightTexture.id = LoadTexture(defaultHeightTexture.path);
+		if (defaultHeightTexture.handle.IsNull())
+			defaultHeightTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultHeightTexture;
 	} else if (type == defaultEmissionTexture.type) {
-		if (defaultEmissionTexture.id == 0)
-			defaultEmissionTexture.id = LoadTexture(defaultEmissionTexture.path);
+		if (defaultEmissionTexture.handle.IsNull())
+			defaultEmissionTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultEmissionTexture;
 	}*/ else {
-		if (defaultUnknownTexture.id == 0)
-			defaultUnknownTexture.id = LoadTexture(defaultUnknownTexture.path);
+		if (defaultUnknownTexture.handle.IsNull())
+			defaultUnknownTexture.handle = TextureHandleFor(LoadTexture(defaultTextureFilename));
 		return defaultUnknownTexture;
 	}
 }
+
+bool IsDefaultTexture(const Texture & texture) {
+	return InternedString(texture.path) == defaultTextureFilename;
+}
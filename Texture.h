@@ -5,6 +5,9 @@
 #include <string>
 #include <unordered_map>
 
+#include <Handle.h>
+#include <StringTable.h>
+
 enum TextureType {
 	TEX_UNKNOWN,
 	TEX_DIFFUSE,
@@ -15,18 +18,117 @@ enum TextureType {
 	TEX_AMBIENT
 };
 
+/**
+* What a material holds of a texture: a generational handle rather than the GL
+* name (TextureId resolves it, 0 once the texture is deleted) and the interned
+* path (InternedString). 12 bytes, no allocation.
+*/
 struct Texture {
-	unsigned int id;
+	TextureHandle handle;
 	TextureType type;
-	std::string path;
+	StringId path;
 };
 
 extern std::unordered_map<TextureType, std::string> TextureTypeName;
 
+struct TextureImage; // TextureCompress.h
+
 /** Methods */
 
 unsigned int LoadTexture(const std::string textureFile, bool gamma = false);
+// Block compress images through a KTX cache next to them (on by default)
+void SetTextureCompression(bool enabled);
 unsigned int LoadCubemap(const std::vector<std::string> & faces);
+// GL thread: the encoded mip chain of an image file's contents, through its KTX cache
+bool LoadTextureImage(const std::string & textureFile, const std::vector<unsigned char> & bytes,
+	bool gamma, TextureType type, TextureImage & image);
+// Handle of a GL texture name, registered on first use; the registry forgets it on delete
+TextureHandle TextureHandleFor(unsigned int id);
+unsigned int TextureId(TextureHandle handle);
 Texture DefaultTexture(TextureType type);
+bool IsDefaultTexture(const Texture & texture);
+
+/**
+* Asynchronous loading: the texture name is returned at once with a 1x1 placeholder,
+* image decoding runs on worker threads and UploadTextures() attaches the pixels
+* on the GL thread.
+*
+* Mips stream in progressively: a texture first gets its tail of 64 texels per
+* side and less, then finer levels one at a time, coarse before fine across all
+* textures. With an upload budget each frame sends at most that many bytes (and
+* at least one step), the rest waits for the next frames.
+*/
+
+unsigned int LoadTextureAsync(const std::string textureFile, bool gamma = false);
+unsigned int UploadTextures(); // GL thread, returns the number of textures completed
+void SetTextureUploadBudget(size_t bytes); // per frame, 0: unlimited (default)
+void ResetTextureUploads(); // once per frame, like ResetDrawStats
+unsigned int PendingTextures(); // decoding or streaming
+void FinishTextures(); // ignores the upload budget
+void SetTextureThreads(unsigned int numThreads); // 0: one per hardware thread
+
+/**
+* Process-wide texture registry, shared by Model, Base2D and Base3D.
+* Keyed by canonical path and by content hash, so identical files in different
+* folders decode and upload once. Every Acquire must be paired with a Release.
+*/
+
+struct TextureCacheStats {
+	unsigned int hits;
+	unsigned int misses;
+	unsigned int textures; // live textures
+	size_t bytes;          // GPU bytes of live textures
+	size_t bytesSaved;     // GPU bytes not duplicated thanks to hits
+};
+
+// type TEX_NORMAL stores two channels (BC5), shaders rebuild z
+unsigned int AcquireTexture(const std::string textureFile, bool gamma = false, bool async = true,
+	TextureType type = TEX_UNKNOWN);
+void ReleaseTexture(unsigned int id);
+TextureCacheStats GetTextureCacheStats();
+
+/** One Acquire of the registry, released on destruction; move-only */
+class TextureRef {
+public:
+	TextureRef() : id(0) {}
+	explicit TextureRef(unsigned int id) : id(id) {} // takes over an AcquireTexture reference
+	TextureRef(TextureRef && other) noexcept;
+	TextureRef & operator=(TextureRef && other) noexcept;
+	~TextureRef();
+
+	unsigned int Id() const { return id; }
+	void Reset(); // releases the reference now
+
+private:
+	unsigned int id;
+
+	TextureRef(const TextureRef &);
+	TextureRef & operator=(const TextureRef &);
+};
+size_t TextureBytes(unsigned int id);
+
+/**
+* Residency: every texture's GPU bytes are tracked against an optional budget.
+* When uploads push the total over it, the least recently bound registry
+* textures drop to their low mips (64 texels per side at most); binding one
+* through BindTexture streams its full chain back in.
+*/
+
+struct TextureResidencyStats {
+	size_t budget;  // 0: unlimited
+	size_t current; // GPU bytes of all tracked textures
+	size_t peak;
+	unsigned int evictions;
+	unsigned int restreams;
+	unsigned int evicted; // textures showing their low mips now
+};
+
+void SetTextureBudget(size_t bytes);
+// GL_TEXTURE_2D on a unit, counted as a use of the texture
+void BindTexture(unsigned int unit, unsigned int id);
+void BindTexture(unsigned int unit, TextureHandle handle);
+// Textures created outside this module (e.g. arrays), 0 bytes to forget one
+void TrackTextureBytes(unsigned int id, size_t bytes);
+TextureResidencyStats GetTextureResidencyStats();
 
 #endif
\ No newline at end of file
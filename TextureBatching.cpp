@@ -0,0 +1,319 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unistd.h>
+
+/** Basic GLFW header */
+//#include <GL/glew.h>	// Important - this header must come before glfw3 header
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+/** GLFW Math */
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+/** Shader Wrapper */
+#include <ShaderProgram.h>
+
+/** Camera Wrapper */
+#include <EularCamera.h>
+
+/** Model Wrapper */
+#include <Model.h>
+#include <TexturePacker.h>
+
+// Global Variables
+const char* APP_TITLE = "Texture Batching -- Arrays and Atlases";
+const int gWindowWidth = 1280;
+const int gWindowHeight = 720;
+GLFWwindow* gWindow = NULL;
+
+// Camera system
+Camera camera(glm::vec3(0.0f, 10.0f, 60.0f));
+
+// The same scene alternates between models drawing their own 2D textures and
+// models drawing packed texture arrays; the averages of each pass are printed.
+const float PASS_SECONDS = 5.0f;
+const int NUM_FANS = 8;
+
+bool use_packed = false;
+
+// Function prototypes
+void processInput(GLFWwindow* window);
+void glfw_onFramebufferSize(GLFWwindow* window, int width, int height);
+void showFPS(GLFWwindow* window);
+bool initOpenGL();
+
+//-----------------------------------------------------------------------------
+// Main Application Entry Point
+//-----------------------------------------------------------------------------
+int main() {
+
+	if (!initOpenGL()){
+		// An error occured
+		std::cerr << "GLFW initialization failed" << std::endl;
+		return -1;
+	}
+
+	// Model loader, every model twice: one set keeps 2D textures, one is packed
+	const char * paths[] = {
+		"Resources/IndustrialFans/IndustrialFans.obj",
+		"Resources/farmhouse/farmhouse.obj",
+		"Resources/warehouse/warehouse.obj",
+		"Resources/CountryHouse/house.obj",
+		"Resources/nanosuit/nanosuit.obj"
+	};
+	const int NUM_MODELS = sizeof(paths) / sizeof(paths[0]);
+
+	unsigned int flags = MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX;
+	std::vector<std::unique_ptr<Model> > plainModels, packedModels;
+	for (int i=0; i<NUM_MODELS; i++) {
+		plainModels.push_back(std::unique_ptr<Model>(new Model(paths[i], false, flags)));
+		packedModels.push_back(std::unique_ptr<Model>(new Model(paths[i], false, flags)));
+	}
+
+	// One packer for the whole scene, so models share arrays too
+	std::unique_ptr<TexturePacker> packer(new TexturePacker);
+	for (auto & model : packedModels) model->QueueTextures(*packer);
+	packer->Pack();
+	for (auto & model : packedModels) model->UsePackedTextures(*packer);
+
+	// Shader loader
+	Shader plainShader("shaders/demo.vert", "shaders/demo.frag");
+	Shader packedShader("shaders/demo.vert", "shaders/demo_layered.frag");
+
+	// Object shader config
+	for (Shader * shader : { &plainShader, &packedShader }) {
+		shader->use();
+		shader->setUniform("uDirectionalLight.direction", 1.0f, -1.0f, 0.0f);
+		shader->setUniform("uDirectionalLight.ambient", 0.5f, 0.5f, 0.5f);
+		shader->setUniform("uDirectionalLight.diffuse", 1.0f, 1.0f, 1.0f);
+		shader->setUniform("uDirectionalLight.specular", 1.0f, 1.0f, 1.0f);
+		shader->setUniform("uSpotLight.diffuse", 0.0f, 0.0f, 0.0f);
+		shader->setUniform("uSpotLight.specular", 0.0f, 0.0f, 0.0f);
+	}
+
+
+
+	// Camera global
+	float aspect = (float)gWindowWidth / (float)gWindowHeight;
+
+	// Placement of each model, fans in a row in front of the houses
+	std::vector<std::pair<int, glm::mat4> > placements;
+	for (int i=0; i<NUM_FANS; i++) {
+		glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(-14.0f + i * 4.0f, -3.5f, 30.0f));
+		placements.push_back(std::make_pair(0, glm::scale(modelMatrix, glm::vec3(0.02f))));
+	}
+	placements.push_back(std::make_pair(1, glm::rotate(
+		glm::translate(glm::mat4(1.0f), glm::vec3(-30.0f, -5.0f, 0.0f)), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f))));
+	placements.push_back(std::make_pair(2, glm::rotate(glm::scale(
+		glm::translate(glm::mat4(1.0f), glm::vec3(30.0f, 0.0f, 0.0f)), glm::vec3(2.0f)), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f))));
+	placements.push_back(std::make_pair(3, glm::scale(
+		glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, -5.0f, 0.0f)), glm::vec3(0.002f))));
+	placements.push_back(std::make_pair(4, glm::scale(
+		glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, -1.0f, 25.0f)), glm::vec3(0.2f))));
+
+	// Pass statistics
+	double passStart = glfwGetTime();
+	double lastFrame = passStart;
+	double frameTimeSum = 0.0;
+	size_t drawCallSum = 0, textureBindSum = 0;
+	size_t uniformIssuedSum = 0, uniformSkippedSum = 0;
+	unsigned int frames = 0;
+
+
+
+	// Rendering loop
+	while (!glfwWindowShouldClose(gWindow)) {
+
+		// Display FPS on title
+		showFPS(gWindow);
+
+		// Key input
+		processInput(gWindow);
+
+		// Clear the screen
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		ResetDrawStats();
+		ResetUniformStats();
+
+		// Camera transformations
+		glm::mat4 view = camera.getViewMatrix();
+		glm::mat4 projection = glm::perspective(glm::radians(camera.fov), aspect, 0.1f, 500.0f);
+
+		Shader & shader = use_packed ? packedShader : plainShader;
+		std::vector<std::unique_ptr<Model> > & models = use_packed ? packedModels : plainModels;
+
+		shader.use();
+		shader.setUniform("uView", view);
+		shader.setUniform("uProjection", projection);
+		shader.setUniform("uCameraPos", camera.position);
+
+		// Render scene
+		for (const auto & placement : placements) {
+			shader.setUniform("uModel", placement.second);
+			models[placement.first]->Draw(shader);
+		}
+
+
+
+		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		glfwPollEvents();
+		glfwSwapBuffers(gWindow);
+
+		// Accumulate the pass
+		double now = glfwGetTime();
+		DrawStats stats = GetDrawStats();
+		frameTimeSum += now - lastFrame;
+		lastFrame = now;
+		drawCallSum += stats.drawCalls;
+		textureBindSum += stats.textureBinds;
+		UniformStats uniformStats = GetUniformStats();
+		uniformIssuedSum += uniformStats.issued;
+		uniformSkippedSum += uniformStats.skipped;
+		frames++;
+
+		if (now - passStart >= PASS_SECONDS) {
+			std::cout << "TextureBatching: " << (use_packed ? "packed" : "plain ")
+				<< "  frames " << frames
+				<< "  frame time " << frameTimeSum * 1000.0 / frames << " ms"
+				<< "  draw calls " << drawCallSum / frames
+				<< "  texture binds " << textureBindSum / frames
+				<< "  uniforms sent " << uniformIssuedSum / frames
+				<< " skipped " << uniformSkippedSum / frames << "\n";
+
+			use_packed = !use_packed;
+			passStart = now;
+			frameTimeSum = 0.0;
+			drawCallSum = textureBindSum = 0;
+			uniformIssuedSum = uniformSkippedSum = 0;
+			frames = 0;
+		}
+	}
+
+	// Models and the packer delete their textures while the context is alive
+	plainModels.clear();
+	packedModels.clear();
+	packer.reset();
+
+	glfwTerminate();
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Initialize GLFW and OpenGL
+//-----------------------------------------------------------------------------
+bool initOpenGL() {
+
+	// Intialize GLFW
+	// GLFW is configured.  Must be called before calling any GLFW functions
+	if (!glfwInit()) {
+		// An error occured
+		std::cerr << "GLFW initialization failed" << std::endl;
+		return false;
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// forward compatible with newer versions of OpenGL as they become available
+	// but not backward compatible (it will not run on devices that do not support OpenGL 3.3
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	// Create an OpenGL 3.3 core, forward compatible context window
+	gWindow = glfwCreateWindow(gWindowWidth, gWindowHeight, APP_TITLE, NULL, NULL);
+	if (gWindow == NULL) {
+		std::cerr << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return false;
+	}
+
+	// Make the window's context the current one
+	glfwMakeContextCurrent(gWindow);
+
+	// Frame time is the measurement, do not wait for vsync
+	glfwSwapInterval(0);
+
+	// Set the required callback functions
+	glfwSetFramebufferSizeCallback(gWindow, glfw_onFramebufferSize);
+
+	// Initialize GLAD: load all OpenGL function pointers
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+
+	// Configure global OpenGL state
+	glEnable(GL_DEPTH_TEST);
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Is called whenever a key is pressed/released via GLFW
+//-----------------------------------------------------------------------------
+void processInput(GLFWwindow* window) {
+
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, GL_TRUE);
+
+	static bool gWireframe = false;
+	if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+		gWireframe = !gWireframe;
+		if (gWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		else glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Is called when the window is resized
+//-----------------------------------------------------------------------------
+void glfw_onFramebufferSize(GLFWwindow* window, int width, int height)
+{
+	glViewport(0, 0, width, height);
+}
+
+//-----------------------------------------------------------------------------
+// Code computes the average frames per second, and also the average time it takes
+// to render one frame.  These stats are appended to the window caption bar.
+//-----------------------------------------------------------------------------
+void showFPS(GLFWwindow* window)
+{
+	static double previousSeconds = 0.0;
+	static int frameCount = 0;
+	double elapsedSeconds;
+	double currentSeconds = glfwGetTime(); // returns number of seconds since GLFW started, as double float
+
+	elapsedSeconds = currentSeconds - previousSeconds;
+
+	// Limit text updates to 4 times per second
+	if (elapsedSeconds > 0.25)
+	{
+		previousSeconds = currentSeconds;
+		double fps = (double)frameCount / elapsedSeconds;
+		double msPerFrame = 1000.0 / fps;
+
+		// The C++ way of setting the window title
+		std::ostringstream outs;
+		outs.precision(3);	// decimal places
+		outs << std::fixed
+			<< APP_TITLE << "    "
+			<< (use_packed ? "packed" : "plain") << "    "
+			<< "FPS: " << fps << "    "
+			<< "Frame Time: " << msPerFrame << " (ms)";
+		glfwSetWindowTitle(window, outs.str().c_str());
+
+		// Reset for next average.
+		frameCount = 0;
+	}
+
+	frameCount++;
+}
@@ -0,0 +1,532 @@
+#include <TextureCompress.h>
+#include <Hash.h>
+#include <MipBuilder.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURECOMPRESS_SSE2
+#include <emmintrin.h>
+#endif
+
+// Bump when the encoder output changes, so stale caches are rebuilt
+static const uint32_t ENCODER_VERSION = 2;
+
+size_t CompressedBlockBytes(GLenum internalFormat) {
+	switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		case GL_COMPRESSED_RED_RGTC1:
+			return 8;
+		default:
+			return 16;
+	}
+}
+
+/*************************************************
+* Blocks
+*************************************************/
+
+// 4x4 RGBA texels of block (bx, by), edges clamped
+static void FetchBlock(const unsigned char * rgba, int width, int height, int bx, int by, unsigned char block[64]) {
+	for (int y=0; y<4; y++) {
+		int sy = std::min(by * 4 + y, height - 1);
+		for (int x=0; x<4; x++) {
+			int sx = std::min(bx * 4 + x, width - 1);
+			std::memcpy(block + (y * 4 + x) * 4, rgba + ((size_t) sy * width + sx) * 4, 4);
+		}
+	}
+}
+
+static uint16_t Pack565(const unsigned char c[3]) {
+	return (uint16_t) (
+		((c[0] * 31 + 127) / 255) << 11 |
+		((c[1] * 63 + 127) / 255) << 5 |
+		((c[2] * 31 + 127) / 255));
+}
+
+static void Unpack565(uint16_t v, unsigned char c[4]) {
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (unsigned char) ((r << 3) | (r >> 2));
+	c[1] = (unsigned char) ((g << 2) | (g >> 4));
+	c[2] = (unsigned char) ((b << 3) | (b >> 2));
+	c[3] = 0;
+}
+
+// 2-bit index of the closest palette color for every texel, texel 0 in the low bits
+static uint32_t MatchColors(const unsigned char block[64], const unsigned char palette[16]) {
+
+	uint32_t result = 0;
+
+#ifdef TEXTURECOMPRESS_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+
+	// Each palette color twice, as 8 x int16
+	__m128i colors[4];
+	for (int k=0; k<4; k++) {
+		int c;
+		std::memcpy(&c, palette + 4 * k, 4);
+		colors[k] = _mm_unpacklo_epi8(_mm_set1_epi32(c), zero);
+	}
+
+	// A row of 4 texels at a time, squared RGB distance to each color
+	for (int row=0; row<4; row++) {
+		__m128i texels = _mm_and_si128(_mm_loadu_si128((const __m128i *) (block + 16 * row)), rgbMask);
+		__m128i lo = _mm_unpacklo_epi8(texels, zero);
+		__m128i hi = _mm_unpackhi_epi8(texels, zero);
+
+		__m128i best = _mm_set1_epi32(INT_MAX);
+		__m128i index = zero;
+		for (int k=0; k<4; k++) {
+			__m128i dlo = _mm_sub_epi16(lo, colors[k]);
+			__m128i dhi = _mm_sub_epi16(hi, colors[k]);
+			dlo = _mm_madd_epi16(dlo, dlo); // r2+g2, b2+a2 per texel
+			dhi = _mm_madd_epi16(dhi, dhi);
+			__m128 even = _mm_shuffle_ps(_mm_castsi128_ps(dlo), _mm_castsi128_ps(dhi), _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 odd  = _mm_shuffle_ps(_mm_castsi128_ps(dlo), _mm_castsi128_ps(dhi), _MM_SHUFFLE(3, 1, 3, 1));
+			__m128i distance = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+
+			__m128i closer = _mm_cmplt_epi32(distance, best);
+			best  = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+			index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, index));
+		}
+
+		int indices[4];
+		_mm_storeu_si128((__m128i *) indices, index);
+		for (int i=0; i<4; i++)
+			result |= (uint32_t) indices[i] << (2 * (row * 4 + i));
+	}
+#else
+	for (int i=0; i<16; i++) {
+		const unsigned char * texel = block + 4 * i;
+		int best = INT_MAX;
+		uint32_t index = 0;
+		for (int k=0; k<4; k++) {
+			int distance = 0;
+			for (int c=0; c<3; c++) {
+				int d = texel[c] - palette[4 * k + c];
+				distance += d * d;
+			}
+			if (distance < best) {
+				best = distance;
+				index = (uint32_t) k;
+			}
+		}
+		result |= index << (2 * i);
+	}
+#endif
+
+	return result;
+}
+
+// BC1 color block, always in 4-color mode (as BC3 decodes it)
+static void EncodeColorBlock(const unsigned char block[64], unsigned char out[8]) {
+
+	unsigned char lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+	for (int i=0; i<16; i++) {
+		for (int c=0; c<3; c++) {
+			lo[c] = std::min(lo[c], block[4 * i + c]);
+			hi[c] = std::max(hi[c], block[4 * i + c]);
+		}
+	}
+
+	// Inset the box by 1/16 of its size, the end points are rarely hit exactly
+	for (int c=0; c<3; c++) {
+		int inset = (hi[c] - lo[c]) >> 4;
+		lo[c] = (unsigned char) (lo[c] + inset);
+		hi[c] = (unsigned char) (hi[c] - inset);
+	}
+
+	// Pick the box diagonal the colors spread along, green is the reference
+	int covRG = 0, covBG = 0;
+	for (int i=0; i<16; i++) {
+		int r = 2 * block[4 * i + 0] - lo[0] - hi[0];
+		int g = 2 * block[4 * i + 1] - lo[1] - hi[1];
+		int b = 2 * block[4 * i + 2] - lo[2] - hi[2];
+		covRG += r * g;
+		covBG += b * g;
+	}
+	if (covRG < 0) std::swap(lo[0], hi[0]);
+	if (covBG < 0) std::swap(lo[2], hi[2]);
+
+	uint16_t c0 = Pack565(hi);
+	uint16_t c1 = Pack565(lo);
+	uint32_t indices = 0;
+
+	if (c0 != c1) {
+		if (c0 < c1) std::swap(c0, c1); // c0 > c1 selects 4-color mode in BC1
+
+		unsigned char palette[16];
+		Unpack565(c0, palette);
+		Unpack565(c1, palette + 4);
+		for (int c=0; c<3; c++) {
+			palette[8 + c]  = (unsigned char) ((2 * palette[c] + palette[4 + c]) / 3);
+			palette[12 + c] = (unsigned char) ((palette[c] + 2 * palette[4 + c]) / 3);
+		}
+		palette[11] = palette[15] = 0;
+		indices = MatchColors(block, palette);
+	}
+
+	out[0] = (unsigned char) (c0 & 0xFF);
+	out[1] = (unsigned char) (c0 >> 8);
+	out[2] = (unsigned char) (c1 & 0xFF);
+	out[3] = (unsigned char) (c1 >> 8);
+	for (int b=0; b<4; b++)
+		out[4 + b] = (unsigned char) (indices >> (8 * b));
+}
+
+// BC4 block of one channel, also the alpha half of BC3 and each half of BC5
+static void EncodeChannelBlock(const unsigned char block[64], int channel, unsigned char out[8]) {
+
+	unsigned char lo = 255, hi = 0;
+	for (int i=0; i<16; i++) {
+		lo = std::min(lo, block[4 * i + channel]);
+		hi = std::max(hi, block[4 * i + channel]);
+	}
+
+	// hi > lo selects 8 levels: code 0 = hi, 1 = lo, 2..7 step from hi to lo
+	uint64_t bits = 0;
+	if (hi > lo) {
+		int range = hi - lo;
+		for (int i=0; i<16; i++) {
+			int t = ((block[4 * i + channel] - lo) * 14 + range) / (2 * range); // 0 = lo .. 7 = hi
+			int code = t == 7 ? 0 : t == 0 ? 1 : 8 - t;
+			bits |= (uint64_t) code << (3 * i);
+		}
+	}
+
+	out[0] = hi;
+	out[1] = lo;
+	for (int b=0; b<6; b++)
+		out[2 + b] = (unsigned char) (bits >> (8 * b));
+}
+
+static void EncodeLevel(const unsigned char * rgba, int width, int height,
+	GLenum internalFormat, std::vector<unsigned char> & data) {
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockBytes = CompressedBlockBytes(internalFormat);
+
+	size_t offset = data.size();
+	data.resize(offset + (size_t) blocksX * blocksY * blockBytes);
+
+	unsigned char block[64];
+	for (int by=0; by<blocksY; by++) {
+		for (int bx=0; bx<blocksX; bx++) {
+			FetchBlock(rgba, width, height, bx, by, block);
+			unsigned char * out = &data[offset + ((size_t) by * blocksX + bx) * blockBytes];
+
+			switch (internalFormat) {
+				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+					EncodeColorBlock(block, out);
+					break;
+				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+					EncodeChannelBlock(block, 3, out);
+					EncodeColorBlock(block, out + 8);
+					break;
+				case GL_COMPRESSED_RED_RGTC1:
+					EncodeChannelBlock(block, 0, out);
+					break;
+				case GL_COMPRESSED_RG_RGTC2:
+					EncodeChannelBlock(block, 0, out);
+					EncodeChannelBlock(block, 1, out + 8);
+					break;
+			}
+		}
+	}
+}
+
+/*************************************************
+* Images
+*************************************************/
+
+// Uncompressed level, channels of baseFormat, rows padded to 4 bytes as KTX stores them
+static void PackLevel(const unsigned char * rgba, int width, int height,
+	int channels, std::vector<unsigned char> & data) {
+
+	size_t rowBytes = ((size_t) width * channels + 3) & ~(size_t) 3;
+	size_t offset = data.size();
+	data.resize(offset + rowBytes * height, 0);
+
+	for (int y=0; y<height; y++) {
+		unsigned char * row = &data[offset + rowBytes * y];
+		for (int x=0; x<width; x++)
+			for (int c=0; c<channels; c++)
+				row[x * channels + c] = rgba[((size_t) y * width + x) * 4 + c];
+	}
+}
+
+static int BaseFormatChannels(GLenum baseFormat) {
+	switch (baseFormat) {
+		case GL_RED: return 1;
+		case GL_RG:  return 2;
+		case GL_RGB: return 3;
+		default:     return 4;
+	}
+}
+
+MipSettings EncodeMipSettings(int nrComponents, bool gamma, bool normalMap, bool opaque) {
+
+	// Kaiser for color, box for normal maps; images with alpha keep their coverage
+	MipSettings settings = DefaultMipSettings();
+	settings.srgb = gamma && !normalMap && nrComponents != 1;
+	settings.normalMap = normalMap;
+	settings.alphaCoverage = !opaque && !normalMap;
+	return settings;
+}
+
+void EncodeImage(const unsigned char * pixels, int width, int height, int nrComponents,
+	bool gamma, bool normalMap, bool blockCompress, TextureImage & image) {
+
+	// Expand to RGBA, gray replicated
+	std::vector<unsigned char> rgba((size_t) width * height * 4);
+	bool opaque = true;
+	for (size_t i=0; i<(size_t) width * height; i++) {
+		const unsigned char * src = pixels + i * nrComponents;
+		unsigned char * dst = &rgba[i * 4];
+		if (nrComponents <= 2) {
+			dst[0] = dst[1] = dst[2] = src[0];
+			dst[3] = nrComponents == 2 ? src[1] : 255;
+		} else {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = nrComponents == 4 ? src[3] : 255;
+		}
+		opaque = opaque && dst[3] == 255;
+	}
+
+	std::vector<std::vector<unsigned char> > levels;
+	BuildMips(rgba.data(), width, height, EncodeMipSettings(nrComponents, gamma, normalMap, opaque), levels);
+
+	EncodeLevels(levels, width, height, nrComponents, gamma, normalMap, blockCompress, image);
+}
+
+void EncodeLevels(const std::vector<std::vector<unsigned char> > & levels, int width, int height,
+	int nrComponents, bool gamma, bool normalMap, bool blockCompress, TextureImage & image) {
+
+	bool opaque = true;
+	const std::vector<unsigned char> & top = levels[0];
+	for (size_t i=3; i<top.size() && opaque; i+=4)
+		opaque = top[i] == 255;
+
+	// Single channel images keep sampling like GL_RED, they have no sRGB variant
+	if (normalMap)
+		image.baseFormat = GL_RG;
+	else if (nrComponents == 1)
+		image.baseFormat = GL_RED;
+	else if (opaque && blockCompress)
+		image.baseFormat = GL_RGB;
+	else
+		image.baseFormat = GL_RGBA; // uncompressed RGB is padded by drivers anyway
+
+	image.type = blockCompress ? 0 : GL_UNSIGNED_BYTE;
+	switch (image.baseFormat) {
+		case GL_RG:
+			image.internalFormat = blockCompress ? GL_COMPRESSED_RG_RGTC2 : GL_RG8;
+			break;
+		case GL_RED:
+			image.internalFormat = blockCompress ? GL_COMPRESSED_RED_RGTC1 : GL_R8;
+			break;
+		case GL_RGB:
+			image.internalFormat = gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			break;
+		default:
+			if (blockCompress)
+				image.internalFormat = gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			else
+				image.internalFormat = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+
+	image.width = width;
+	image.height = height;
+	image.levelOffsets.clear();
+	image.levelSizes.clear();
+	image.data.clear();
+
+	int levelWidth = width, levelHeight = height;
+	for (const std::vector<unsigned char> & level : levels) {
+		size_t offset = image.data.size();
+		if (blockCompress)
+			EncodeLevel(level.data(), levelWidth, levelHeight, image.internalFormat, image.data);
+		else
+			PackLevel(level.data(), levelWidth, levelHeight, BaseFormatChannels(image.baseFormat), image.data);
+		image.levelOffsets.push_back(offset);
+		image.levelSizes.push_back(image.data.size() - offset);
+
+		levelWidth = std::max(levelWidth / 2, 1);
+		levelHeight = std::max(levelHeight / 2, 1);
+	}
+}
+
+/*************************************************
+* KTX 1.1 container
+*************************************************/
+
+static const unsigned char KTX_IDENTIFIER[12] = {
+	0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+static const uint32_t KTX_ENDIANNESS = 0x04030201;
+static const char KTX_SOURCE_KEY[] = "learnOpenGL.source"; // value: uint64 cache key
+
+struct KtxHeader {
+	unsigned char identifier[12];
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+};
+
+uint64_t TextureCacheKey(const void * bytes, size_t length, bool gamma, bool normalMap, bool blockCompress) {
+	uint32_t settings[4] = { ENCODER_VERSION, gamma ? 1u : 0u, normalMap ? 1u : 0u, blockCompress ? 1u : 0u };
+	return HashBytes(settings, sizeof(settings), HashBytes(bytes, length));
+}
+
+std::string TextureCachePath(const std::string & imagePath, bool gamma, bool normalMap, bool blockCompress) {
+	return imagePath + (normalMap ? ".normal" : gamma ? ".srgb" : "") + (blockCompress ? "" : ".raw") + ".ktx";
+}
+
+bool WriteKtx(const std::string & path, uint64_t key, const TextureImage & image) {
+
+	// One key/value pair, padded to 4 bytes
+	uint32_t keyValueSize = (uint32_t) (sizeof(KTX_SOURCE_KEY) + sizeof(key));
+	uint32_t keyValuePadding = (4 - keyValueSize % 4) % 4;
+
+	KtxHeader header;
+	std::memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+	header.endianness = KTX_ENDIANNESS;
+	header.glType = image.type; // 0 when block compressed
+	header.glTypeSize = 1;
+	header.glFormat = image.type ? image.baseFormat : 0;
+	header.glInternalFormat = image.internalFormat;
+	header.glBaseInternalFormat = image.baseFormat;
+	header.pixelWidth = (uint32_t) image.width;
+	header.pixelHeight = (uint32_t) image.height;
+	header.pixelDepth = 0;
+	header.numberOfArrayElements = 0;
+	header.numberOfFaces = 1;
+	header.numberOfMipmapLevels = (uint32_t) image.levelSizes.size();
+	header.bytesOfKeyValueData = (uint32_t) sizeof(uint32_t) + keyValueSize + keyValuePadding;
+
+	// Write to a temporary file and rename, so a reader never sees a partial file
+	std::string tempPath = path + ".tmp";
+	std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+
+	const unsigned char padding[4] = { 0, 0, 0, 0 };
+	file.write((const char *) &header, sizeof(header));
+	file.write((const char *) &keyValueSize, sizeof(keyValueSize));
+	file.write(KTX_SOURCE_KEY, sizeof(KTX_SOURCE_KEY));
+	file.write((const char *) &key, sizeof(key));
+	file.write((const char *) padding, keyValuePadding);
+
+	// Block sizes and padded rows are multiples of 4, no mip padding needed
+	for (size_t level=0; level<image.levelSizes.size(); level++) {
+		uint32_t imageSize = (uint32_t) image.levelSizes[level];
+		file.write((const char *) &imageSize, sizeof(imageSize));
+		file.write((const char *) &image.data[image.levelOffsets[level]], imageSize);
+	}
+
+	file.close();
+	if (!file) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ReadKtx(const std::string & path, uint64_t key, TextureImage & image) {
+
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+
+	std::streamsize length = file.tellg();
+	if (length < (std::streamsize) sizeof(KtxHeader)) return false;
+	file.seekg(0, std::ios::beg);
+
+	std::vector<unsigned char> bytes((size_t) length);
+	if (!file.read((char *) bytes.data(), length)) return false;
+
+	KtxHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0 ||
+		header.endianness != KTX_ENDIANNESS || header.glTypeSize != 1 ||
+		header.numberOfFaces != 1 || header.numberOfArrayElements != 0 ||
+		header.numberOfMipmapLevels == 0)
+		return false;
+
+	size_t pos = sizeof(header);
+	size_t keyValueEnd = pos + header.bytesOfKeyValueData;
+	if (keyValueEnd > bytes.size()) return false;
+
+	// Only a file written for this source and these settings is valid
+	bool keyFound = false;
+	while (pos + sizeof(uint32_t) <= keyValueEnd) {
+		uint32_t keyValueSize;
+		std::memcpy(&keyValueSize, &bytes[pos], sizeof(keyValueSize));
+		pos += sizeof(keyValueSize);
+		if (pos + keyValueSize > keyValueEnd) return false;
+
+		if (keyValueSize == sizeof(KTX_SOURCE_KEY) + sizeof(key) &&
+			std::memcmp(&bytes[pos], KTX_SOURCE_KEY, sizeof(KTX_SOURCE_KEY)) == 0) {
+			uint64_t storedKey;
+			std::memcpy(&storedKey, &bytes[pos + sizeof(KTX_SOURCE_KEY)], sizeof(storedKey));
+			keyFound = storedKey == key;
+		}
+		pos += keyValueSize + (4 - keyValueSize % 4) % 4;
+	}
+	if (!keyFound) return false;
+	pos = keyValueEnd;
+
+	image.type = header.glType;
+	image.internalFormat = header.glInternalFormat;
+	image.baseFormat = header.glBaseInternalFormat;
+	image.width = (int) header.pixelWidth;
+	image.height = (int) header.pixelHeight;
+	image.levelOffsets.clear();
+	image.levelSizes.clear();
+	image.data.clear();
+
+	for (uint32_t level=0; level<header.numberOfMipmapLevels; level++) {
+		uint32_t imageSize;
+		if (pos + sizeof(imageSize) > bytes.size()) return false;
+		std::memcpy(&imageSize, &bytes[pos], sizeof(imageSize));
+		pos += sizeof(imageSize);
+		if (pos + imageSize > bytes.size()) return false;
+
+		image.levelOffsets.push_back(pos);
+		image.levelSizes.push_back(imageSize);
+		pos += imageSize + (4 - imageSize % 4) % 4;
+	}
+
+	// Levels are used in place, the header stays in front of them
+	image.data.swap(bytes);
+	return true;
+}
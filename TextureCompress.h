@@ -0,0 +1,72 @@
+#ifndef TEXTURECOMPRESS_H
+#define TEXTURECOMPRESS_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include <MipBuilder.h>
+
+/**
+* Texture encoding on the CPU: a mip chain from MipBuilder, block compressed
+* or kept as 8-bit levels when the driver has no S3TC.
+*
+*   BC1 (DXT1)  opaque color, 8 bytes per 4x4 block
+*   BC3 (DXT5)  color + alpha, 16 bytes
+*   BC4 (RGTC1) single channel images, 8 bytes, samples like GL_RED
+*   BC5 (RGTC2) normal maps, x and y only, 16 bytes; shaders rebuild z
+*
+* Endpoints come from the inset bounding box of a block, oriented along its main
+* diagonal; palette matching runs on SSE2 where available. Results are cached as
+* KTX 1.1 files next to the image, keyed by the image contents, so warm loads
+* neither encode nor build mips.
+*/
+
+// EXT_texture_compression_s3tc and EXT_texture_sRGB, not part of the core profile
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+struct TextureImage {
+	GLenum type;       // 0 when block compressed, else GL_UNSIGNED_BYTE
+	GLenum internalFormat;
+	GLenum baseFormat; // GL_RED, GL_RG, GL_RGB or GL_RGBA, the pixel format of uncompressed levels
+	int width, height;
+	std::vector<size_t> levelOffsets; // into data, one per mip level; rows padded to 4 bytes
+	std::vector<size_t> levelSizes;
+	std::vector<unsigned char> data;
+};
+
+/** Methods */
+
+// pixels holds width * height * nrComponents bytes, as decoded by stb_image
+void EncodeImage(const unsigned char * pixels, int width, int height, int nrComponents,
+	bool gamma, bool normalMap, bool blockCompress, TextureImage & image);
+// A chain already built, RGBA levels as from BuildMips; nrComponents of the source
+// picks the format the same way as EncodeImage
+void EncodeLevels(const std::vector<std::vector<unsigned char> > & levels, int width, int height,
+	int nrComponents, bool gamma, bool normalMap, bool blockCompress, TextureImage & image);
+MipSettings EncodeMipSettings(int nrComponents, bool gamma, bool normalMap, bool opaque);
+
+// key identifies the source contents and settings, see TextureCacheKey
+bool ReadKtx(const std::string & path, uint64_t key, TextureImage & image);
+bool WriteKtx(const std::string & path, uint64_t key, const TextureImage & image);
+
+uint64_t TextureCacheKey(const void * bytes, size_t length, bool gamma, bool normalMap, bool blockCompress);
+std::string TextureCachePath(const std::string & imagePath, bool gamma, bool normalMap, bool blockCompress);
+
+size_t CompressedBlockBytes(GLenum internalFormat);
+
+#endif
@@ -0,0 +1,362 @@
+#include <TexturePacker.h>
+#include <Texture.h>
+#include <TextureCompress.h>
+#include <MipBuilder.h>
+#include <Hash.h>
+#include <UploadRing.h>
+
+#include <stb_image/stb_image.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <string>
+
+/*************************************************
+* Binding
+*************************************************/
+
+static const unsigned int MAX_ARRAY_UNITS = 32;
+static GLuint boundArrays[MAX_ARRAY_UNITS];
+
+bool BindTextureArray(unsigned int unit, GLuint id) {
+	if (unit < MAX_ARRAY_UNITS && boundArrays[unit] == id) return false;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+	if (unit < MAX_ARRAY_UNITS) boundArrays[unit] = id;
+	return true;
+}
+
+/*************************************************
+* Upload
+*************************************************/
+
+// Layers share format, size and level count; returns the array name
+static GLuint UploadLayers(const std::vector<const TextureImage *> & images, size_t & bytes) {
+
+	GLuint id = 0;
+	glGenTextures(1, &id);
+	BindTextureArray(0, id);
+
+	const TextureImage & first = *images[0];
+	GLsizei layers = (GLsizei) images.size();
+	int width = first.width, height = first.height;
+	size_t arrayBytes = 0;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (size_t level=0; level<first.levelSizes.size(); level++) {
+		size_t levelBytes = first.levelSizes[level];
+
+		// Storage for every layer first, then one upload per layer
+		if (first.type == 0)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, first.internalFormat,
+				width, height, layers, 0, (GLsizei) (levelBytes * layers), NULL);
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, first.internalFormat,
+				width, height, layers, 0, first.baseFormat, first.type, NULL);
+
+		for (GLsizei layer=0; layer<layers; layer++) {
+			const void * data = StageTextureData(&images[layer]->data[images[layer]->levelOffsets[level]], levelBytes);
+			if (first.type == 0)
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, 0, 0, layer,
+					width, height, 1, first.internalFormat, (GLsizei) levelBytes, data);
+			else
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint) level, 0, 0, layer,
+					width, height, 1, first.baseFormat, first.type, data);
+		}
+		EndTextureStaging(); // the next level's storage is allocated from NULL
+
+		arrayBytes += levelBytes * layers;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint) first.levelSizes.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	TrackTextureBytes(id, arrayBytes);
+	bytes += arrayBytes;
+	return id;
+}
+
+static bool ReadFileBytes(const std::string & filename, std::vector<unsigned char> & bytes) {
+	std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+	std::streamsize length = file.tellg();
+	file.seekg(0, std::ios::beg);
+	bytes.resize((size_t) length);
+	return length > 0 && file.read((char *) bytes.data(), length);
+}
+
+/*************************************************
+* Atlas
+*************************************************/
+
+struct PackSource {
+	unsigned int entry;
+	std::string file;
+	std::vector<unsigned char> bytes;
+	TextureImage image;
+};
+
+struct AtlasTile {
+	size_t source;
+	int x, y; // corner of the gutter
+};
+
+// RGBA of an image with a gutter of replicated edge texels on every side
+static void PadTile(const unsigned char * rgba, int width, int height, int gutter,
+	std::vector<unsigned char> & padded) {
+
+	int paddedWidth = width + 2 * gutter, paddedHeight = height + 2 * gutter;
+	padded.resize((size_t) paddedWidth * paddedHeight * 4);
+	for (int y=0; y<paddedHeight; y++) {
+		int sy = std::min(std::max(y - gutter, 0), height - 1);
+		for (int x=0; x<paddedWidth; x++) {
+			int sx = std::min(std::max(x - gutter, 0), width - 1);
+			std::copy(&rgba[((size_t) sy * width + sx) * 4], &rgba[((size_t) sy * width + sx) * 4] + 4,
+				&padded[((size_t) y * paddedWidth + x) * 4]);
+		}
+	}
+}
+
+// The page through its own cache file next to the first tile's image, keyed by
+// the contents and places of all tiles. Every tile keeps its own mip chain,
+// its level l lands at (x >> l, y >> l) of page level l.
+static bool BuildAtlasPage(const std::vector<AtlasTile> & page, const std::vector<PackSource> & sources,
+	bool gamma, bool normalMap, TextureImage & image) {
+
+	const int gutter = TexturePacker::ATLAS_GUTTER;
+	int width = 0, height = 0;
+	std::vector<uint64_t> layout;
+	for (const AtlasTile & tile : page) {
+		const TextureImage & source = sources[tile.source].image;
+		width = std::max(width, tile.x + source.width + 2 * gutter);
+		height = std::max(height, tile.y + source.height + 2 * gutter);
+		layout.push_back(HashBytes(sources[tile.source].bytes.data(), sources[tile.source].bytes.size()));
+		layout.push_back(((uint64_t) tile.x << 32) | (uint64_t) tile.y);
+	}
+
+	bool blockCompress = sources[page[0].source].image.type == 0;
+	uint64_t key = TextureCacheKey(layout.data(), layout.size() * sizeof(uint64_t), gamma, normalMap, blockCompress);
+	std::string cachePath = TextureCachePath(sources[page[0].source].file + ".atlas", gamma, normalMap, blockCompress);
+	if (ReadKtx(cachePath, key, image) && image.width == width && image.height == height) return true;
+
+	// Decode every tile first, the page format follows the richest one
+	std::vector<std::vector<unsigned char> > pixels(page.size());
+	std::vector<bool> opaque(page.size(), true);
+	int nrComponents = 1;
+	for (size_t t=0; t<page.size(); t++) {
+		const PackSource & source = sources[page[t].source];
+		int w, h, n;
+		unsigned char * data = stbi_load_from_memory(source.bytes.data(), (int) source.bytes.size(), &w, &h, &n, 4);
+		if (!data || w != source.image.width || h != source.image.height) {
+			stbi_image_free(data);
+			std::cerr << "TexturePacker: cannot decode " << source.file << "\n";
+			return false;
+		}
+		pixels[t].assign(data, data + (size_t) w * h * 4);
+		stbi_image_free(data);
+		for (size_t i=3; i<pixels[t].size() && opaque[t]; i+=4)
+			opaque[t] = pixels[t][i] == 255;
+		nrComponents = std::max(nrComponents, n);
+	}
+
+	// Unused texels are opaque black, they must not turn an opaque page into BC3
+	int numLevels = NumMipLevels(width, height);
+	if (numLevels > TexturePacker::ATLAS_LEVELS) numLevels = TexturePacker::ATLAS_LEVELS;
+	std::vector<std::vector<unsigned char> > levels(numLevels);
+	for (int l=0; l<numLevels; l++) {
+		size_t texels = (size_t) std::max(width >> l, 1) * std::max(height >> l, 1);
+		levels[l].assign(texels * 4, 0);
+		for (size_t i=0; i<texels; i++) levels[l][i * 4 + 3] = 255;
+	}
+
+	std::vector<unsigned char> padded;
+	std::vector<std::vector<unsigned char> > tileLevels;
+	for (size_t t=0; t<page.size(); t++) {
+		const TextureImage & source = sources[page[t].source].image;
+		int tileWidth = source.width + 2 * gutter, tileHeight = source.height + 2 * gutter;
+		PadTile(pixels[t].data(), source.width, source.height, gutter, padded);
+		BuildMips(padded.data(), tileWidth, tileHeight,
+			EncodeMipSettings(nrComponents, gamma, normalMap, opaque[t]), tileLevels);
+
+		for (int l=0; l<numLevels; l++) {
+			int levelWidth = std::max(width >> l, 1);
+			int rowWidth = std::max(tileWidth >> l, 1), rows = std::max(tileHeight >> l, 1);
+			for (int y=0; y<rows; y++)
+				std::copy(&tileLevels[l][(size_t) y * rowWidth * 4], &tileLevels[l][(size_t) (y + 1) * rowWidth * 4],
+					&levels[l][(((size_t) (page[t].y >> l) + y) * levelWidth + (page[t].x >> l)) * 4]);
+		}
+	}
+
+	EncodeLevels(levels, width, height, nrComponents, gamma, normalMap, blockCompress, image);
+	if (!WriteKtx(cachePath, key, image))
+		std::cerr << "TexturePacker: cannot write " << cachePath << "\n";
+	return true;
+}
+
+/*************************************************
+* Packer
+*************************************************/
+
+TexturePacker :: TexturePacker() : packed(0), stats() {}
+
+TexturePacker :: ~TexturePacker() {
+	for (GLuint id : arrays) {
+		TrackTextureBytes(id, 0);
+		for (unsigned int unit=0; unit<MAX_ARRAY_UNITS; unit++)
+			if (boundArrays[unit] == id) boundArrays[unit] = 0; // deleting unbinds
+	}
+	if (!arrays.empty()) glDeleteTextures((GLsizei) arrays.size(), arrays.data());
+}
+
+unsigned int TexturePacker :: Add(const std::string & textureFile, bool gamma, TextureType type) {
+
+	std::string key = textureFile + (gamma ? "#srgb#" : "#") + std::to_string((int) type);
+	auto it = entryIndex.find(key);
+	if (it != entryIndex.end()) return it->second;
+
+	Entry entry;
+	entry.file = textureFile;
+	entry.gamma = gamma;
+	entry.layer.id = 0;
+	entry.layer.type = type;
+	entry.layer.layer = 0;
+	entry.layer.uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+
+	unsigned int index = (unsigned int) entries.size();
+	entries.push_back(entry);
+	entryIndex[key] = index;
+	return index;
+}
+
+void TexturePacker :: Pack() {
+
+	// Let pending decodes write their cache files first; after that the chains
+	// below are the same ones LoadTexture would upload, read from the cache
+	FinishTextures();
+
+	std::vector<PackSource> sources;
+	sources.reserve(entries.size() - packed);
+	for (size_t i=packed; i<entries.size(); i++) {
+		PackSource source;
+		source.entry = (unsigned int) i;
+		source.file = entries[i].file;
+		if (!ReadFileBytes(entries[i].file, source.bytes) ||
+			!LoadTextureImage(entries[i].file, source.bytes, entries[i].gamma, entries[i].layer.type, source.image)) {
+			std::cerr << "TexturePacker: Texture failed to load at path: " << entries[i].file << "\n";
+			continue;
+		}
+		sources.push_back(std::move(source));
+	}
+	packed = entries.size();
+	stats.textures += (unsigned int) sources.size();
+
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (maxLayers <= 0) maxLayers = 256; // the GL 3.3 minimum
+
+	// Same format and size: layers of one array
+	std::map<std::tuple<GLenum, int, int, size_t>, std::vector<size_t> > groups;
+	for (size_t i=0; i<sources.size(); i++) {
+		const TextureImage & image = sources[i].image;
+		groups[std::make_tuple(image.internalFormat, image.width, image.height, image.levelSizes.size())].push_back(i);
+	}
+
+	// Leftovers small enough for a tile, grouped by what the encoder keys on
+	const int align = 1 << (ATLAS_LEVELS - 1);
+	std::map<std::pair<bool, bool>, std::vector<size_t> > atlasGroups;
+
+	for (auto & group : groups) {
+		const TextureImage & image = sources[group.second[0]].image;
+		if (group.second.size() == 1 &&
+			image.width <= ATLAS_MAX_TILE && image.height <= ATLAS_MAX_TILE &&
+			image.width % align == 0 && image.height % align == 0) {
+			const Entry & entry = entries[sources[group.second[0]].entry];
+			atlasGroups[std::make_pair(entry.gamma, entry.layer.type == TEX_NORMAL)].push_back(group.second[0]);
+			continue;
+		}
+
+		for (size_t first=0; first<group.second.size(); first+=(size_t) maxLayers) {
+			size_t last = std::min(first + (size_t) maxLayers, group.second.size());
+			std::vector<const TextureImage *> images;
+			for (size_t i=first; i<last; i++)
+				images.push_back(&sources[group.second[i]].image);
+
+			GLuint id = UploadLayers(images, stats.bytes);
+			arrays.push_back(id);
+			stats.arrays++;
+
+			for (size_t i=first; i<last; i++) {
+				TextureLayer & layer = entries[sources[group.second[i]].entry].layer;
+				layer.id = id;
+				layer.layer = (int) (i - first);
+			}
+			stats.layers += (unsigned int) (last - first);
+		}
+	}
+
+	for (auto & atlasGroup : atlasGroups) {
+		bool gamma = atlasGroup.first.first;
+		bool normalMap = atlasGroup.first.second;
+		std::vector<size_t> & members = atlasGroup.second;
+
+		// Shelves, tallest tiles first; gutters keep every corner on the alignment
+		std::sort(members.begin(), members.end(), [&](size_t a, size_t b) {
+			return std::make_pair(sources[a].image.height, sources[a].image.width) >
+				std::make_pair(sources[b].image.height, sources[b].image.width);
+		});
+
+		std::vector<std::vector<AtlasTile> > pages(1);
+		int shelfX = 0, shelfY = 0, shelfHeight = 0;
+		for (size_t source : members) {
+			int tileWidth = sources[source].image.width + 2 * ATLAS_GUTTER;
+			int tileHeight = sources[source].image.height + 2 * ATLAS_GUTTER;
+			if (shelfX + tileWidth > ATLAS_PAGE_SIZE) {
+				shelfX = 0;
+				shelfY += shelfHeight;
+				shelfHeight = 0;
+			}
+			if (shelfY + tileHeight > ATLAS_PAGE_SIZE) {
+				pages.push_back(std::vector<AtlasTile>());
+				shelfX = shelfY = 0;
+			}
+			AtlasTile tile = { source, shelfX, shelfY };
+			pages.back().push_back(tile);
+			shelfX += tileWidth;
+			shelfHeight = std::max(shelfHeight, tileHeight);
+		}
+
+		for (const std::vector<AtlasTile> & page : pages) {
+			TextureImage image;
+			if (!BuildAtlasPage(page, sources, gamma, normalMap, image)) continue;
+
+			std::vector<const TextureImage *> images(1, &image);
+			GLuint id = UploadLayers(images, stats.bytes);
+			arrays.push_back(id);
+			stats.arrays++;
+			stats.atlasPages++;
+
+			for (const AtlasTile & tile : page) {
+				const TextureImage & source = sources[tile.source].image;
+				TextureLayer & layer = entries[sources[tile.source].entry].layer;
+				layer.id = id;
+				layer.layer = 0;
+				layer.uvTransform = glm::vec4(
+					(float) source.width / image.width, (float) source.height / image.height,
+					(float) (tile.x + ATLAS_GUTTER) / image.width, (float) (tile.y + ATLAS_GUTTER) / image.height);
+			}
+			stats.atlased += (unsigned int) page.size();
+		}
+	}
+}
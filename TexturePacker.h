@@ -0,0 +1,88 @@
+#ifndef TEXTUREPACKER_H
+#define TEXTUREPACKER_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <Texture.h>
+
+/**
+* Packs material textures into GL_TEXTURE_2D_ARRAY layers, so meshes whose
+* materials differ keep sampling the same arrays and texture binds collapse.
+*
+* Textures of the same size and format become layers of one array. Small
+* leftovers of odd sizes go to atlas pages instead: each tile gets a gutter
+* of replicated edge texels and its own mip chain, so neither filtering nor
+* mipmapping bleeds between tiles. An atlas page is an array of one layer,
+* shaders reach the tile through uvTransform.
+*
+* Shaders index layers with the MatTexLayer_t convention of demo_layered.frag:
+*   uMaterial.texture_diffuse1.map          sampler2DArray
+*   uMaterial.texture_diffuse1.layer        float
+*   uMaterial.texture_diffuse1.uvTransform  vec4, xy scale and zw offset
+*/
+
+/** Where a packed texture lives */
+struct TextureLayer {
+	unsigned int id;       // GL_TEXTURE_2D_ARRAY name, 0 if the image failed to load
+	TextureType type;
+	int layer;
+	glm::vec4 uvTransform; // (1, 1, 0, 0) for a whole layer
+};
+
+struct TexturePackStats {
+	unsigned int textures;   // distinct source textures
+	unsigned int arrays;     // array textures, atlas pages included
+	unsigned int layers;     // textures packed as whole layers
+	unsigned int atlased;    // textures packed as atlas tiles
+	unsigned int atlasPages;
+	size_t bytes;            // GPU bytes of all arrays
+};
+
+class TexturePacker {
+
+public:
+	/** Params */
+	static const int ATLAS_MAX_TILE = 256; // larger textures always get a layer
+	static const int ATLAS_PAGE_SIZE = 1024;
+	static const int ATLAS_GUTTER = 16;    // texels per side, keeps ATLAS_LEVELS mips apart
+	static const int ATLAS_LEVELS = 5;
+
+	/** Methods */
+	TexturePacker();
+	~TexturePacker();
+
+	// Queue an image file, returns its entry. The same file, gamma and type
+	// share an entry.
+	unsigned int Add(const std::string & textureFile, bool gamma, TextureType type);
+	// GL thread: packs the entries queued since the last call into new arrays
+	void Pack();
+	const TextureLayer & Layer(unsigned int entry) const { return entries[entry].layer; }
+	TexturePackStats Stats() const { return stats; }
+
+private:
+	struct Entry {
+		std::string file;
+		bool gamma;
+		TextureLayer layer;
+	};
+
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, unsigned int> entryIndex;
+	size_t packed; // entries before this one are packed
+	std::vector<GLuint> arrays;
+	TexturePackStats stats;
+
+	TexturePacker(const TexturePacker &);
+	TexturePacker & operator=(const TexturePacker &);
+};
+
+// Binds a texture array to a unit unless it is bound there already,
+// returns whether a bind was issued
+bool BindTextureArray(unsigned int unit, GLuint id);
+
+#endif
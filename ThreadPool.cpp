@@ -0,0 +1,115 @@
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+ThreadPool :: ThreadPool(unsigned int numThreads)
+	: active(0), stop(false)
+{
+	if (numThreads == 0)
+		numThreads = HardwareThreads();
+
+	for (unsigned int i=0; i<numThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::run, this));
+}
+
+ThreadPool :: ~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+	}
+	wakeup.notify_all();
+
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+unsigned int ThreadPool :: HardwareThreads() {
+	unsigned int n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+void ThreadPool :: Submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	wakeup.notify_one();
+}
+
+void ThreadPool :: Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this] { return jobs.empty() && active == 0; });
+}
+
+// Shared by the caller and the helper jobs of one ParallelFor; helpers that
+// start after the loop is over find no index left and only drop their reference
+struct ParallelBatch {
+	std::function<void(size_t)> fn;
+	size_t count;
+	std::atomic<size_t> next;
+	std::atomic<size_t> done;
+	std::mutex mutex;
+	std::condition_variable finished;
+};
+
+static void RunBatch(ParallelBatch & batch) {
+	size_t ran = 0;
+	for (size_t i; (i = batch.next++) < batch.count; ran++)
+		batch.fn(i);
+	if (ran && (batch.done += ran) == batch.count) {
+		std::lock_guard<std::mutex> lock(batch.mutex);
+		batch.finished.notify_all();
+	}
+}
+
+void ThreadPool :: ParallelFor(size_t count, const std::function<void(size_t)> & fn) {
+
+	if (count == 0) return;
+
+	std::shared_ptr<ParallelBatch> batch = std::make_shared<ParallelBatch>();
+	batch->fn = fn;
+	batch->count = count;
+	batch->next = 0;
+	batch->done = 0;
+
+	size_t helpers = std::min((size_t) Size(), count - 1);
+	for (size_t h=0; h<helpers; h++)
+		Submit([batch] { RunBatch(*batch); });
+
+	RunBatch(*batch);
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->finished.wait(lock, [&batch] { return batch->done == batch->count; });
+}
+
+void ThreadPool :: run() {
+
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeup.wait(lock, [this] { return stop || !jobs.empty(); });
+			if (stop) return; // jobs not yet started are dropped
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			active++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			active--;
+			if (jobs.empty() && active == 0)
+				idle.notify_all();
+		}
+	}
+}
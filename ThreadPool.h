@@ -0,0 +1,43 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class ThreadPool {
+public:
+	/** Methods */
+	explicit ThreadPool(unsigned int numThreads = 0); // 0: one per hardware thread
+	~ThreadPool(); // jobs that have not started yet are dropped
+
+	void Submit(std::function<void()> job);
+	void Wait(); // block until every submitted job has finished
+
+	// fn(0) .. fn(count - 1) on the workers and the calling thread, returns once
+	// all have run. The caller takes indices too, so the loop finishes even while
+	// the workers are busy with other jobs.
+	void ParallelFor(size_t count, const std::function<void(size_t)> & fn);
+
+	unsigned int Size() const { return (unsigned int) workers.size(); }
+	static unsigned int HardwareThreads();
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > jobs;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::condition_variable idle;
+	unsigned int active;
+	bool stop;
+
+	void run();
+
+	ThreadPool(const ThreadPool &);
+	ThreadPool & operator=(const ThreadPool &);
+};
+
+#endif
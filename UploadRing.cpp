@@ -0,0 +1,221 @@
+#include <UploadRing.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+
+/** Staged ranges start aligned for every texel and index type */
+static const size_t RING_ALIGNMENT = 64;
+
+struct FencedRange {
+	size_t begin, end; // never wraps
+	uint64_t serial;   // last staging inside
+	GLsync fence;
+};
+
+static size_t ringSize = 32 << 20;
+static GLuint ringBuffer = 0;
+static size_t ringCapacity = 0;
+static size_t ringHead = 0;    // next free byte
+static size_t stagedBegin = 0; // start of the staged range not fenced yet
+static std::deque<FencedRange> inFlight;
+
+static uint64_t stagedSerial = 0;
+static uint64_t fencedSerial = 0;
+static uint64_t completedSerial = 0;
+
+static UploadStats uploadStats = {};
+static size_t frameBytes = 0;
+static double frameStallMs = 0.0;
+
+/*************************************************
+* Fences
+*************************************************/
+
+static void FenceStaged() {
+	if (fencedSerial == stagedSerial) return;
+	FencedRange range = { stagedBegin, ringHead, stagedSerial, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) };
+	inFlight.push_back(range);
+	fencedSerial = stagedSerial;
+	stagedBegin = ringHead;
+}
+
+// Pops the oldest fence once the GPU passed it, blocking for it if wait
+static bool RetireOldest(bool wait) {
+
+	FencedRange & range = inFlight.front();
+	GLenum status = glClientWaitSync(range.fence, 0, 0);
+
+	if (wait && status == GL_TIMEOUT_EXPIRED) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		do status = glClientWaitSync(range.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+		while (status == GL_TIMEOUT_EXPIRED);
+		frameStallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	if (status == GL_TIMEOUT_EXPIRED) return false;
+
+	completedSerial = range.serial;
+	glDeleteSync(range.fence);
+	inFlight.pop_front();
+	return true;
+}
+
+static void RetireSignaled() {
+	while (!inFlight.empty() && RetireOldest(false));
+}
+
+/*************************************************
+* Ring
+*************************************************/
+
+static bool CreateRing() {
+
+	if (ringBuffer) return true;
+	if (ringSize == 0) return false;
+
+	glGenBuffers(1, &ringBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+	glBufferData(GL_COPY_READ_BUFFER, ringSize, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	ringCapacity = ringSize;
+	ringHead = stagedBegin = 0;
+	return ringBuffer != 0;
+}
+
+static bool Overlaps(const FencedRange & range, size_t offset, size_t bytes) {
+	return range.begin < offset + bytes && offset < range.end;
+}
+
+// Space for bytes, once the GPU is done reading whatever was staged there before
+static bool Reserve(size_t bytes, size_t & offset) {
+
+	if (!CreateRing() || bytes > ringCapacity) return false;
+
+	offset = ringHead;
+	if (offset + bytes > ringCapacity) {
+		FenceStaged(); // so fenced ranges never wrap
+		offset = stagedBegin = 0;
+	}
+
+	// Ranges retire in order, the oldest ones lie right after the head
+	for (;;) {
+		bool overlap = false;
+		for (const FencedRange & range : inFlight)
+			if (Overlaps(range, offset, bytes)) overlap = true;
+		if (!overlap) break;
+		RetireOldest(true);
+	}
+
+	ringHead = std::min((offset + bytes + RING_ALIGNMENT - 1) / RING_ALIGNMENT * RING_ALIGNMENT, ringCapacity);
+	return true;
+}
+
+static bool CopyToRing(const void * data, size_t bytes, size_t & offset) {
+
+	if (!Reserve(bytes, offset)) return false;
+
+	// Unsynchronized: Reserve already waited for the range
+	glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+	void * mapped = glMapBufferRange(GL_COPY_READ_BUFFER, (GLintptr) offset, (GLsizeiptr) bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	bool copied = false;
+	if (mapped) {
+		std::memcpy(mapped, data, bytes);
+		copied = glUnmapBuffer(GL_COPY_READ_BUFFER) == GL_TRUE;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	if (copied) stagedSerial++;
+	return copied;
+}
+
+/*************************************************
+* Uploads
+*************************************************/
+
+void SetUploadRingSize(size_t bytes) {
+
+	FenceStaged();
+	while (!inFlight.empty()) RetireOldest(true);
+
+	if (ringBuffer) glDeleteBuffers(1, &ringBuffer);
+	ringBuffer = 0;
+	ringCapacity = 0;
+	ringSize = bytes;
+}
+
+const void * StageTextureData(const void * data, size_t bytes) {
+
+	if (!data || !bytes) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return data;
+	}
+	frameBytes += bytes;
+
+	size_t offset;
+	if (!CopyToRing(data, bytes, offset)) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		uploadStats.directUploads++;
+		return data;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ringBuffer);
+	return reinterpret_cast<const void *>(offset);
+}
+
+void EndTextureStaging() {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void StageBufferData(GLuint buffer, size_t offset, const void * data, size_t bytes) {
+
+	if (!bytes || !data) return;
+	frameBytes += bytes;
+
+	// The copy targets leave the VAO and array buffer bindings alone
+	size_t ringOffset;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (CopyToRing(data, bytes, ringOffset)) {
+		glBindBuffer(GL_COPY_READ_BUFFER, ringBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			(GLintptr) ringOffset, (GLintptr) offset, (GLsizeiptr) bytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	} else {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr) offset, (GLsizeiptr) bytes, data);
+		uploadStats.directUploads++;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+uint64_t UploadSerial() {
+	return stagedSerial;
+}
+
+bool UploadsComplete(uint64_t serial) {
+	if (serial <= completedSerial) return true;
+	// Not waiting for the end of the frame keeps this working without EndUploadFrame
+	if (serial > fencedSerial) FenceStaged();
+	RetireSignaled();
+	return serial <= completedSerial;
+}
+
+void EndUploadFrame() {
+
+	FenceStaged();
+	RetireSignaled();
+
+	uploadStats.frameBytes = frameBytes;
+	uploadStats.frameStallMs = frameStallMs;
+	uploadStats.totalBytes += frameBytes;
+	uploadStats.totalStallMs += frameStallMs;
+	frameBytes = 0;
+	frameStallMs = 0.0;
+}
+
+UploadStats GetUploadStats() {
+	return uploadStats;
+}
@@ -0,0 +1,55 @@
+#ifndef UPLOADRING_H
+#define UPLOADRING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+/**
+* Staging ring for texture and buffer uploads.
+*
+* Data is copied into one large GL buffer, mapped unsynchronized, and the GPU
+* copies it on from there: texture levels read it as GL_PIXEL_UNPACK_BUFFER,
+* buffers through glCopyBufferSubData. The driver then neither blocks the
+* call nor keeps a copy of its own.
+*
+* Staged ranges are fenced with glFenceSync at the end of every frame (or when
+* the ring wraps). Writing over a range waits for its fence, which is the only
+* place the CPU can stall. Draw code asks UploadsComplete() before it uses data
+* that has to be on the GPU already. Data larger than the ring is uploaded
+* directly. GL thread only.
+*/
+
+struct UploadStats {
+	size_t frameBytes;      // staged during the last frame
+	double frameStallMs;    // waited on fences during the last frame
+	size_t totalBytes;
+	double totalStallMs;
+	unsigned int directUploads; // too large for the ring, or the ring is off
+};
+
+/** Methods */
+
+// Ring capacity, 0 uploads everything directly. Waits for work in flight.
+void SetUploadRingSize(size_t bytes);
+
+// Stages data and binds the ring to GL_PIXEL_UNPACK_BUFFER; returns what to
+// pass as the pixels pointer of the next glTex(Sub)Image call. Unbind with
+// EndTextureStaging() before a call that passes NULL to allocate storage.
+const void * StageTextureData(const void * data, size_t bytes);
+void EndTextureStaging();
+
+// glBufferSubData through the ring, leaves the VAO and array buffer bindings alone
+void StageBufferData(GLuint buffer, size_t offset, const void * data, size_t bytes);
+
+// Serial of everything staged so far, and whether the GPU has consumed it
+uint64_t UploadSerial();
+bool UploadsComplete(uint64_t serial);
+
+// Once per frame, after its uploads: fences them and rolls the frame statistics
+void EndUploadFrame();
+
+UploadStats GetUploadStats();
+
+#endif
@@ -0,0 +1,194 @@
+#include <VertexFormat.h>
+#include <Mesh.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <string>
+
+const std::string VertexFormatName[NUM_VERTEX_FORMATS] = {
+	"float",
+	"compact",
+	"compact_unorm_uv"
+};
+
+size_t VertexSize(VertexFormat format) {
+	return format == VERTEX_FLOAT ? sizeof(Vertex) : sizeof(CompactVertex);
+}
+
+VertexDequant IdentityDequant() {
+	VertexDequant dequant;
+	dequant.positionScale  = glm::vec3(1.0f);
+	dequant.positionOffset = glm::vec3(0.0f);
+	dequant.texCoordScale  = glm::vec2(1.0f);
+	dequant.texCoordOffset = glm::vec2(0.0f);
+	return dequant;
+}
+
+/*************************************************
+* Octahedral encoding
+*************************************************/
+
+static float SignNotZero(float v) {
+	return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+glm::vec2 OctEncode(const glm::vec3 & n) {
+	float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if (l1 == 0.0f) return glm::vec2(0.0f); // decodes to +z
+	glm::vec3 p = n / l1;
+	if (p.z >= 0.0f) return glm::vec2(p.x, p.y);
+	return glm::vec2(
+		(1.0f - std::fabs(p.y)) * SignNotZero(p.x),
+		(1.0f - std::fabs(p.x)) * SignNotZero(p.y));
+}
+
+glm::vec3 OctDecode(const glm::vec2 & e) {
+	glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+	if (n.z < 0.0f) {
+		n.x = (1.0f - std::fabs(e.y)) * SignNotZero(e.x);
+		n.y = (1.0f - std::fabs(e.x)) * SignNotZero(e.y);
+	}
+	return glm::normalize(n);
+}
+
+static int16_t Snorm16(float v) {
+	return (int16_t) std::lround(glm::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static uint16_t Unorm16(float v) {
+	return (uint16_t) std::lround(glm::clamp(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+/*************************************************
+* Encoding
+*************************************************/
+
+VertexDequant EncodeVertices(
+	const Vertex * vertices, size_t numVertices,
+	VertexFormat format,
+	std::vector<unsigned char> & out) {
+
+	VertexDequant dequant = IdentityDequant();
+	out.resize(numVertices * VertexSize(format));
+
+	if (format == VERTEX_FLOAT) {
+		if (numVertices) std::memcpy(out.data(), vertices, out.size());
+		return dequant;
+	}
+
+	// Quantization bounds
+	glm::vec3 pmin(0.0f), pmax(0.0f);
+	glm::vec2 tmin(0.0f), tmax(0.0f);
+	if (numVertices) {
+		pmin = pmax = vertices[0].position;
+		tmin = tmax = vertices[0].texCoords;
+	}
+	for (size_t i=1; i<numVertices; i++) {
+		pmin = glm::min(pmin, vertices[i].position);
+		pmax = glm::max(pmax, vertices[i].position);
+		tmin = glm::min(tmin, vertices[i].texCoords);
+		tmax = glm::max(tmax, vertices[i].texCoords);
+	}
+
+	glm::vec3 pextent = pmax - pmin;
+	for (int k=0; k<3; k++) if (pextent[k] == 0.0f) pextent[k] = 1.0f;
+	dequant.positionScale  = pextent;
+	dequant.positionOffset = pmin;
+
+	glm::vec2 textent = tmax - tmin;
+	for (int k=0; k<2; k++) if (textent[k] == 0.0f) textent[k] = 1.0f;
+	if (format == VERTEX_COMPACT_UNORM_UV) {
+		dequant.texCoordScale  = textent;
+		dequant.texCoordOffset = tmin;
+	}
+
+	CompactVertex * compact = (CompactVertex *) out.data();
+	for (size_t i=0; i<numVertices; i++) {
+		const Vertex & v = vertices[i];
+		CompactVertex & c = compact[i];
+
+		glm::vec3 p = (v.position - pmin) / pextent;
+		float sign = glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? 0.0f : 1.0f;
+		c.position[0] = Unorm16(p.x);
+		c.position[1] = Unorm16(p.y);
+		c.position[2] = Unorm16(p.z);
+		c.position[3] = Unorm16(sign);
+
+		glm::vec2 n = OctEncode(v.normal);
+		glm::vec2 t = OctEncode(v.tangent);
+		c.normal[0]  = Snorm16(n.x);
+		c.normal[1]  = Snorm16(n.y);
+		c.tangent[0] = Snorm16(t.x);
+		c.tangent[1] = Snorm16(t.y);
+
+		if (format == VERTEX_COMPACT_UNORM_UV) {
+			glm::vec2 uv = (v.texCoords - tmin) / textent;
+			c.texCoords[0] = Unorm16(uv.x);
+			c.texCoords[1] = Unorm16(uv.y);
+		} else {
+			c.texCoords[0] = glm::packHalf1x16(v.texCoords.x);
+			c.texCoords[1] = glm::packHalf1x16(v.texCoords.y);
+		}
+	}
+
+	return dequant;
+}
+
+void DecodePositions(
+	const void * data, size_t numVertices,
+	VertexFormat format, const VertexDequant & dequant,
+	glm::vec3 * out) {
+
+	if (format == VERTEX_FLOAT) {
+		const Vertex * vertices = (const Vertex *) data;
+		for (size_t i=0; i<numVertices; i++)
+			out[i] = vertices[i].position;
+		return;
+	}
+
+	const CompactVertex * compact = (const CompactVertex *) data;
+	for (size_t i=0; i<numVertices; i++) {
+		glm::vec3 p(compact[i].position[0], compact[i].position[1], compact[i].position[2]);
+		out[i] = p / 65535.0f * dequant.positionScale + dequant.positionOffset;
+	}
+}
+
+/*************************************************
+* Attributes
+*************************************************/
+
+void SetupVertexAttributes(VertexFormat format) {
+
+	if (format == VERTEX_FLOAT) {
+		glEnableVertexAttribArray(0); // vertex positions
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
+		glEnableVertexAttribArray(1); // vertex normals
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(2); // vertex texture coords
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+		glEnableVertexAttribArray(3); // vertex tangent coords
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+		glEnableVertexAttribArray(4); // vertex bitangent coords
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+		return;
+	}
+
+	GLenum texCoordType = format == VERTEX_COMPACT_UNORM_UV ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT;
+	GLboolean texCoordNormalized = format == VERTEX_COMPACT_UNORM_UV ? GL_TRUE : GL_FALSE;
+
+	glEnableVertexAttribArray(0); // quantized position, w = bitangent sign
+	glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), NULL);
+	glEnableVertexAttribArray(1); // octahedral normal
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+	glEnableVertexAttribArray(2); // texture coords
+	glVertexAttribPointer(2, 2, texCoordType, texCoordNormalized, sizeof(CompactVertex), (void*)offsetof(CompactVertex, texCoords));
+	glEnableVertexAttribArray(3); // octahedral tangent
+	glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, tangent));
+	glDisableVertexAttribArray(4); // bitangent is reconstructed
+}
@@ -0,0 +1,75 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+struct Vertex;
+
+/**
+* GPU vertex layouts a Mesh can be uploaded with. Attribute locations stay the
+* same as Vertex (0 position, 1 normal, 2 texCoords, 3 tangent, 4 bitangent),
+* shaders decode the compact ones through the uVertex uniform.
+*
+*   VERTEX_FLOAT            56 bytes, Vertex as is
+*   VERTEX_COMPACT          20 bytes
+*     position  4 x unorm16, xyz quantized to the mesh bounds, w = bitangent sign
+*     normal    2 x snorm16, octahedral
+*     tangent   2 x snorm16, octahedral, bitangent = sign * cross(normal, tangent)
+*     texCoords 2 x half
+*   VERTEX_COMPACT_UNORM_UV 20 bytes, as above with texCoords 2 x unorm16
+*                           quantized to the mesh UV bounds
+*/
+
+enum VertexFormat {
+	VERTEX_FLOAT,
+	VERTEX_COMPACT,
+	VERTEX_COMPACT_UNORM_UV,
+	NUM_VERTEX_FORMATS
+};
+
+struct CompactVertex {
+	uint16_t position[4];
+	int16_t  normal[2];
+	int16_t  tangent[2];
+	uint16_t texCoords[2];
+};
+
+/** Maps stored attributes back to model space: value = stored * scale + offset */
+struct VertexDequant {
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	glm::vec2 texCoordScale;
+	glm::vec2 texCoordOffset;
+};
+
+extern const std::string VertexFormatName[NUM_VERTEX_FORMATS];
+
+/** Methods */
+
+size_t VertexSize(VertexFormat format);
+VertexDequant IdentityDequant();
+
+/** Encode vertices in format, out receives numVertices * VertexSize(format) bytes */
+VertexDequant EncodeVertices(
+	const Vertex * vertices, size_t numVertices,
+	VertexFormat format,
+	std::vector<unsigned char> & out);
+
+/** Model space positions of encoded vertices, out receives numVertices of them */
+void DecodePositions(
+	const void * data, size_t numVertices,
+	VertexFormat format, const VertexDequant & dequant,
+	glm::vec3 * out);
+
+/** Point attributes 0-4 of the bound VAO at the bound GL_ARRAY_BUFFER */
+void SetupVertexAttributes(VertexFormat format);
+
+glm::vec2 OctEncode(const glm::vec3 & n);
+glm::vec3 OctDecode(const glm::vec2 & e);
+
+#endif
@@ -1,6 +1,6 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
@@ -12,16 +12,50 @@ uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProjection;
 
+struct Vertex_t {
+	int format; // 0: float, otherwise compact (see VertexFormat.h)
+	vec3 positionScale;
+	vec3 positionOffset;
+	vec2 texCoordScale;
+	vec2 texCoordOffset;
+};
+
+uniform Vertex_t uVertex;
+
+// Node placements of a shared mesh, see Mesh::Draw (0: drawn once at uModel)
+const int MAX_INSTANCES = 32;
+uniform mat4 uInstances[MAX_INSTANCES];
+uniform int uInstanceCount;
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
 void main() {
 
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	vec3 position = aPos.xyz;
+	vec3 normal = aNormal;
+	vec2 texCoords = aTexCoords;
+
+	if (uVertex.format != 0) {
+		position = aPos.xyz * uVertex.positionScale + uVertex.positionOffset;
+		normal = octDecode(aNormal.xy);
+		texCoords = aTexCoords * uVertex.texCoordScale + uVertex.texCoordOffset;
+	}
+
+	mat4 model = uModel;
+	if (uInstanceCount > 0) model = uModel * uInstances[gl_InstanceID];
+
+	gl_Position = uProjection * uView * model * vec4(position, 1.0f);
 
 	// Get one fragment's position in World Space
-	FragPos = vec3(uModel * vec4(aPos, 1.0));
+	FragPos = vec3(model * vec4(position, 1.0));
 
 	// Also don't forget to transform normal vector
 	//Normal = mat3(transpose(inverse(uModel))) * aNormal;
-	Normal = mat3(uModel) * aNormal;
+	Normal = mat3(model) * normal;
 
-	TexCoords = aTexCoords;
+	TexCoords = texCoords;
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+#version 330 core
+
+/** Directional Light */
+
+struct Directional_Light_t {
+	vec3 direction;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+vec3 CalcDirectionalLight(Directional_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular, vec3 emission);
+
+/** Point Light */
+
+struct  Point_Light_t {
+	vec3 position;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+vec3 CalcPointLight(Point_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular);
+
+/** Spot Light */
+
+struct Spot_Light_t {
+	vec3 position;
+	vec3 direction;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	float innerCutOff;
+	float outerCutOff;
+};
+
+vec3 CalcSpotLight(Spot_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular);
+
+/** Texture mapping */
+
+// A packed texture: a layer of an array, or a tile of an atlas page
+struct MatTexLayer_t {
+	sampler2DArray map;
+	float layer;
+	vec4 uvTransform; // xy scale, zw offset of the tile; (1, 1, 0, 0) for a whole layer
+};
+
+vec4 SampleLayer(sampler2DArray map, float layer, vec4 uvTransform, vec2 uv);
+
+struct MatTexMap_t {
+	// texture diffuse
+	MatTexLayer_t texture_diffuse1;
+	MatTexLayer_t texture_diffuse2;
+	MatTexLayer_t texture_diffuse3;
+	MatTexLayer_t texture_diffuse4;
+	// texture specular
+	MatTexLayer_t texture_specular1;
+	MatTexLayer_t texture_specular2;
+	MatTexLayer_t texture_specular3;
+	MatTexLayer_t texture_specular4;
+	// texture normal
+	MatTexLayer_t texture_normal1;
+	MatTexLayer_t texture_normal2;
+	// texture height
+	MatTexLayer_t texture_height1;
+	MatTexLayer_t texture_height2;
+	// texture emission
+	MatTexLayer_t texture_emission1;
+	MatTexLayer_t texture_emission2;
+	// To be added ...
+};
+
+/** Uniform variables */
+
+// Camera
+uniform vec3 uCameraPos;
+
+// Lighting
+#define NR_POINT_LIGHTS 4
+uniform Directional_Light_t uDirectionalLight;
+uniform Spot_Light_t uSpotLight;
+uniform Point_Light_t uPointLights[NR_POINT_LIGHTS];
+
+// Texture (Model Importer specified)
+uniform MatTexMap_t uMaterial;
+
+/** Stream variables */
+
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+void main() {
+
+	vec3 normal = normalize(Normal);
+	vec3 viewDir = normalize(uCameraPos - FragPos);
+	vec3 resultColor = vec3(0.0, 0.0, 0.0);
+
+	// Sample each map once, the lights share them
+	vec3 diffuse = SampleLayer(uMaterial.texture_diffuse1.map, uMaterial.texture_diffuse1.layer,
+		uMaterial.texture_diffuse1.uvTransform, TexCoords).rgb;
+	vec3 specular = SampleLayer(uMaterial.texture_specular1.map, uMaterial.texture_specular1.layer,
+		uMaterial.texture_specular1.uvTransform, TexCoords).rgb;
+	vec3 emission = SampleLayer(uMaterial.texture_emission1.map, uMaterial.texture_emission1.layer,
+		uMaterial.texture_emission1.uvTransform, TexCoords).rgb;
+
+	// Directional lighting
+	resultColor += CalcDirectionalLight(uDirectionalLight, normal, viewDir,
+		diffuse, specular, emission);
+
+	// Spot lighting
+	resultColor += CalcSpotLight(uSpotLight, normal, viewDir,
+		diffuse, specular);
+
+	// Point lighting
+	/**
+	for (int i=0; i<NR_POINT_LIGHTS; i++) {
+		resultColor += CalcPointLight(uPointLights[i], normal, viewDir,
+			diffuse, specular);
+	}*/
+
+	// Result
+	FragColor = vec4(resultColor, 1.0);
+}
+
+vec4 SampleLayer(sampler2DArray map, float layer, vec4 uvTransform, vec2 uv) {
+	// Tiles clamp like GL_CLAMP_TO_EDGE, their gutters hold the edge texels
+	if (uvTransform.xy != vec2(1.0))
+		uv = uvTransform.zw + uvTransform.xy * clamp(uv, 0.0, 1.0);
+	return texture(map, vec3(uv, layer));
+}
+
+vec3 CalcDirectionalLight(Directional_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular, vec3 emission) {
+
+	vec3 lightDir = normalize(-light.direction);
+	// ambient
+	vec3 ambientColor = light.ambient * diffuse;
+	// diffuse
+	float diffEff = max(dot(normal, lightDir), 0.0);
+	vec3 diffuseColor = diffEff * light.diffuse * diffuse;
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
+	vec3 specularColor = specEff * light.specular * specular;
+	// emission
+	vec3 emissionColor = vec3(0.0);
+	if (specular.r == 0.0)
+		emissionColor = emission;
+	// result
+	return ambientColor + diffuseColor + specularColor + emissionColor;
+}
+
+vec3 CalcPointLight(Point_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular) {
+
+	vec3 lightDir = normalize(light.position - FragPos);
+	// Physics
+	float distance = length(light.position - FragPos);
+	float attenuation = 1.0 / (light.constant + light.linear*distance + light.quadratic*distance*distance);
+	// ambient
+	vec3 ambientColor = light.ambient * diffuse;
+	// diffuse
+	float diffEff = max(dot(normal, lightDir), 0.0);
+	vec3 diffuseColor = diffEff * light.diffuse * diffuse;
+	// specular
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
+	vec3 specularColor = specEff * light.specular * specular;
+	// result
+	return attenuation * (ambientColor + diffuseColor + specularColor);
+}
+
+vec3 CalcSpotLight(Spot_Light_t light, vec3 normal, vec3 viewDir,
+	vec3 diffuse, vec3 specular) {
+
+	vec3 lightDir = normalize(light.position - FragPos);
+	// Physics
+	float distance = length(light.position - FragPos);
+	float attenuation = 1.0 / (light.constant + light.linear*distance + light.quadratic*distance*distance);
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.innerCutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+	// Ambient lighting
+	vec3 ambientColor = light.ambient * diffuse;
+	// Diffuse lighting
+	float diffEff = max(dot(normal, lightDir), 0.0);
+	vec3 diffuseColor = diffEff * light.diffuse * diffuse;
+	// Specular lighting
+	vec3 reflectDir = reflect(-lightDir, normal);
+	float specEff = pow(max(dot(viewDir, reflectDir), 0.0), 64.0);
+	vec3 specularColor = specEff * light.specular * specular;
+	// Result lighting
+	return attenuation * (ambientColor + (diffuseColor + specularColor) * intensity);
+}
@@ -85,6 +85,9 @@ vec3 CalcEmission(
 	vec2 texCoords,
 	sampler2D emission);
 
+// Normal maps may be two channel (BC5), z is rebuilt from x and y
+vec3 UnpackNormal(vec2 xy);
+
 vec2 ParallaxMapping(
 	vec2 texCoords, sampler2D depth, float scale,
 	vec3 viewDir, vec3 normal);
@@ -133,8 +136,7 @@ void main() {
 			transpose(fs_in.TBN) * viewDir, transpose(fs_in.TBN) * fs_in.Normal);
 		if (texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
 			discard;
-		normal = texture(uMaterial.texture_normal1, texCoords).rgb;
-		normal = normalize(normal * 2.0 - 1.0);
+		normal = UnpackNormal(texture(uMaterial.texture_normal1, texCoords).rg);
 		normal = normalize(fs_in.TBN * normal);
 	}
 
@@ -266,3 +268,8 @@ vec3 CalcEmission(vec2 texCoords, sampler2D emission) {
 	vec3 emissionColor = texture(emission, texCoords).rgb;
 	return emissionColor;
 }
+
+vec3 UnpackNormal(vec2 xy) {
+	xy = xy * 2.0 - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
@@ -85,6 +85,9 @@ vec3 CalcEmission(
 	vec2 texCoords,
 	sampler2D emission);
 
+// Normal maps may be two channel (BC5), z is rebuilt from x and y
+vec3 UnpackNormal(vec2 xy);
+
 /** Uniform variables */
 
 // Camera
@@ -121,8 +124,7 @@ void main() {
 	vec3 resultColor = vec3(0.0, 0.0, 0.0);
 
 	if (uEnableNormal) {
-		normal = texture(uMaterial.texture_normal1, fs_in.TexCoords).rgb;
-		normal = normalize(normal * 2.0 - 1.0);
+		normal = UnpackNormal(texture(uMaterial.texture_normal1, fs_in.TexCoords).rg);
 		normal = normalize(fs_in.TBN * normal);
 	}
 
@@ -220,3 +222,8 @@ vec3 CalcEmission(vec2 texCoords, sampler2D emission) {
 	vec3 emissionColor = texture(emission, texCoords).rgb;
 	return emissionColor;
 }
+
+vec3 UnpackNormal(vec2 xy) {
+	xy = xy * 2.0 - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
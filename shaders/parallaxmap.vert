@@ -1,6 +1,6 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
@@ -17,18 +17,56 @@ uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProjection;
 
+struct Vertex_t {
+	int format; // 0: float, otherwise compact (see VertexFormat.h)
+	vec3 positionScale;
+	vec3 positionOffset;
+	vec2 texCoordScale;
+	vec2 texCoordOffset;
+};
+
+uniform Vertex_t uVertex;
+
+// Node placements of a shared mesh, see Mesh::Draw (0: drawn once at uModel)
+const int MAX_INSTANCES = 32;
+uniform mat4 uInstances[MAX_INSTANCES];
+uniform int uInstanceCount;
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+	return normalize(n);
+}
+
 void main() {
 
-	mat3 normalMatrix = mat3(transpose(inverse(uModel)));
+	vec3 position = aPos.xyz;
+	vec3 normal = aNormal;
+	vec2 texCoords = aTexCoords;
+	vec3 tangent = aTangent;
+	vec3 bitangent = aBitangent;
+
+	if (uVertex.format != 0) {
+		position = aPos.xyz * uVertex.positionScale + uVertex.positionOffset;
+		normal = octDecode(aNormal.xy);
+		texCoords = aTexCoords * uVertex.texCoordScale + uVertex.texCoordOffset;
+		tangent = octDecode(aTangent.xy);
+		bitangent = cross(normal, tangent) * (aPos.w * 2.0 - 1.0);
+	}
+
+	mat4 model = uModel;
+	if (uInstanceCount > 0) model = uModel * uInstances[gl_InstanceID];
+
+	mat3 normalMatrix = mat3(transpose(inverse(model)));
 
-	vec3 T = normalize(normalMatrix * aTangent);
-	vec3 B = normalize(normalMatrix * aBitangent);
-	vec3 N = normalize(normalMatrix * aNormal);
+	vec3 T = normalize(normalMatrix * tangent);
+	vec3 B = normalize(normalMatrix * bitangent);
+	vec3 N = normalize(normalMatrix * normal);
 
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	gl_Position = uProjection * uView * model * vec4(position, 1.0f);
 
-	vs_out.FragPos = vec3(uModel * vec4(aPos, 1.0));
-	vs_out.Normal = normalMatrix * aNormal;
-	vs_out.TexCoords = aTexCoords;
+	vs_out.FragPos = vec3(model * vec4(position, 1.0));
+	vs_out.Normal = normalMatrix * normal;
+	vs_out.TexCoords = texCoords;
 	vs_out.TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+/**
+* Parallel import benchmark: reads each model once with ASSIMP, the same way
+* Model::loadModel does, then times the per-mesh CPU work (ImportMesh) with 1,
+* 2, 4 ... N threads through ThreadPool::ParallelFor and prints the speedup
+* over one thread. Defaults to sponza and IndustrialFans.
+*
+* Build from the repository root:
+*   g++ -std=c++14 -O2 -pthread -I. -Icommon/includes utils/importbench.cpp MeshImport.cpp MeshOptimizer.cpp ThreadPool.cpp -lassimp -o importbench
+*   ./importbench [model ...]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <Model.h>
+#include <MeshImport.h>
+#include <ThreadPool.h>
+
+static const int RUNS = 3;
+
+static void CollectMeshes(const aiNode * node, const aiScene * scene, std::vector<const aiMesh *> & work) {
+	for (unsigned int i=0; i<node->mNumMeshes; i++)
+		work.push_back(scene->mMeshes[node->mMeshes[i]]);
+	for (unsigned int i=0; i<node->mNumChildren; i++)
+		CollectMeshes(node->mChildren[i], scene, work);
+}
+
+// Best of RUNS, numThreads counts the calling thread
+static double ImportMs(const std::vector<const aiMesh *> & work, unsigned int flags, unsigned int numThreads) {
+
+	// ThreadPool(0) would mean one per hardware thread, one thread runs alone
+	std::unique_ptr<ThreadPool> pool;
+	if (numThreads > 1) pool.reset(new ThreadPool(numThreads - 1));
+
+	double best = 1e30;
+	for (int r=0; r<RUNS; r++) {
+		std::vector<ImportedMesh> geometry(work.size());
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (pool)
+			pool->ParallelFor(work.size(), [&](size_t i) { ImportMesh(work[i], flags, geometry[i]); });
+		else
+			for (size_t i=0; i<work.size(); i++) ImportMesh(work[i], flags, geometry[i]);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+int main(int argc, char ** argv) {
+
+	std::vector<std::string> files;
+	for (int i=1; i<argc; i++) files.push_back(argv[i]);
+	if (files.empty()) {
+		files.push_back("Resources/sponza/sponza.obj");
+		files.push_back("Resources/IndustrialFans/IndustrialFans.obj");
+	}
+
+	const unsigned int flags = MODEL_OPTIMIZE_MESH | MODEL_GENERATE_LODS;
+	unsigned int cores = ThreadPool::HardwareThreads();
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int t=1; t<cores; t*=2) threadCounts.push_back(t);
+	threadCounts.push_back(cores);
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (const std::string & file : files) {
+
+		Assimp::Importer importer;
+		const aiScene * scene = importer.ReadFile(file,
+			aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			std::cerr << file << ": " << importer.GetErrorString() << "\n";
+			continue;
+		}
+
+		std::vector<const aiMesh *> work;
+		CollectMeshes(scene->mRootNode, scene, work);
+		size_t vertices = 0;
+		for (const aiMesh * mesh : work) vertices += mesh->mNumVertices;
+		std::cout << file << ": " << work.size() << " meshes, " << vertices << " vertices\n";
+
+		double serial = 0.0;
+		for (unsigned int t : threadCounts) {
+			double ms = ImportMs(work, flags, t);
+			if (t == 1) serial = ms;
+			std::cout << "  " << std::setw(3) << t << " threads " << std::setw(9) << ms << " ms  "
+				<< std::setprecision(2) << serial / ms << "x\n" << std::setprecision(1);
+		}
+	}
+
+	return 0;
+}
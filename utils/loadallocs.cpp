@@ -0,0 +1,92 @@
+/**
+* Load-time allocation count: opens a hidden GL window, loads each model once
+* cold (its mesh cache is removed first) and once warm, and prints the number
+* of operator new calls and bytes each load made. Defaults to sponza.
+*
+* Build from the repository root (macOS, like the Makefile):
+*   g++ -std=c++14 -O2 -pthread -framework opengl -I. -Icommon/includes -Lcommon/lib \
+*     utils/loadallocs.cpp ShaderProgram.cpp StringTable.cpp EularCamera.cpp ThreadPool.cpp UploadRing.cpp \
+*     Texture.cpp TextureCompress.cpp MipBuilder.cpp TexturePacker.cpp Material.cpp VertexFormat.cpp \
+*     GeometryArena.cpp Mesh.cpp MeshImport.cpp MeshCache.cpp MeshOptimizer.cpp SceneGraph.cpp \
+*     Model.cpp -lglfw -lglad -lassimp -o loadallocs
+*   ./loadallocs [model ...]
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <Model.h>
+#include <Texture.h>
+
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> allocatedBytes(0);
+
+void * operator new(size_t bytes) {
+	allocations++;
+	allocatedBytes += bytes;
+	void * p = std::malloc(bytes ? bytes : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+	std::free(p);
+}
+
+static void CountLoad(const std::string & path, const char * label) {
+
+	size_t count = allocations, bytes = allocatedBytes;
+	{
+		Model model(path, false, MODEL_OPTIMIZE_MESH | MODEL_COMPACT_VERTEX);
+		FinishTextures();
+	}
+	std::cout << path << " (" << label << "): " << allocations - count << " allocations, "
+		<< (allocatedBytes - bytes) / (1024.0 * 1024.0) << " MB\n";
+}
+
+int main(int argc, char ** argv) {
+
+	std::vector<std::string> models;
+	for (int i=1; i<argc; i++) models.push_back(argv[i]);
+	if (models.empty()) models.push_back("Resources/sponza/sponza.obj");
+
+	if (!glfwInit()) return 1;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	GLFWwindow * window = glfwCreateWindow(64, 64, "loadallocs", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+		glfwTerminate();
+		return 1;
+	}
+
+	for (const std::string & path : models) {
+		std::remove((path + ".meshcache").c_str());
+		CountLoad(path, "cold");
+		CountLoad(path, "warm");
+	}
+
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,172 @@
+/**
+* Vertex extraction benchmark: converts a synthetic aiMesh (default 4M
+* vertices, 8M triangles) into Vertex and index arrays with the per-vertex
+* loop processMesh used to run and with MeshImport, checks both agree and
+* prints the best of a few runs.
+*
+* Build from the repository root:
+*   g++ -std=c++14 -O2 -I. -Icommon/includes utils/meshbench.cpp MeshImport.cpp -o meshbench
+*   ./meshbench [vertices]
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <assimp/mesh.h>
+
+#include <Mesh.h>
+#include <MeshImport.h>
+
+using namespace std;
+
+static const int RUNS = 5;
+
+// The loop from Model::processMesh before MeshImport
+static void legacyExtract(const aiMesh * mesh, vector<Vertex> & vertices, vector<unsigned int> & indices) {
+
+	for (unsigned int i=0; i<mesh->mNumVertices; i++) {
+
+		Vertex vertex;
+		glm::vec3 v;
+
+		if (mesh->mVertices) {
+			v.x = mesh->mVertices[i].x;
+			v.y = mesh->mVertices[i].y;
+			v.z = mesh->mVertices[i].z;
+			vertex.position = v;
+		}
+
+		if (mesh->mNormals) {
+			v.x = mesh->mNormals[i].x;
+			v.y = mesh->mNormals[i].y;
+			v.z = mesh->mNormals[i].z;
+			vertex.normal = v;
+		} else {
+			vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+
+		if (mesh->mTextureCoords[0]) { // mTextureCoords is an array, only its slots can be null
+			glm::vec2 u;
+			u.x = mesh->mTextureCoords[0][i].x;
+			u.y = mesh->mTextureCoords[0][i].y;
+			vertex.texCoords = u;
+		} else {
+			vertex.texCoords = glm::vec2(0.0f, 0.0f);
+		}
+
+		if (mesh->mTangents) {
+			v.x = mesh->mTangents[i].x;
+			v.y = mesh->mTangents[i].y;
+			v.z = mesh->mTangents[i].z;
+			vertex.tangent = v;
+		} else {
+			vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+		}
+
+		if (mesh->mBitangents) {
+			v.x = mesh->mBitangents[i].x;
+			v.y = mesh->mBitangents[i].y;
+			v.z = mesh->mBitangents[i].z;
+			vertex.bitangent = v;
+		} else {
+			vertex.bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+
+		vertices.push_back(vertex);
+	}
+
+	for (unsigned int i=0; i<mesh->mNumFaces; i++) {
+		aiFace face = mesh->mFaces[i];
+		for (unsigned int j=0; j<face.mNumIndices; j++)
+			indices.push_back(face.mIndices[j]);
+	}
+}
+
+static aiVector3D * randomVectors(unsigned int n) {
+	aiVector3D * v = new aiVector3D[n];
+	for (unsigned int i=0; i<n; i++)
+		v[i] = aiVector3D((float) rand() / RAND_MAX, (float) rand() / RAND_MAX, (float) rand() / RAND_MAX);
+	return v;
+}
+
+// A grid of quads, two triangles each; tangents left out to exercise the defaults
+static aiMesh * makeMesh(unsigned int numVertices) {
+
+	aiMesh * mesh = new aiMesh;
+	mesh->mNumVertices = numVertices;
+	mesh->mVertices = randomVectors(numVertices);
+	mesh->mNormals = randomVectors(numVertices);
+	mesh->mTextureCoords[0] = randomVectors(numVertices);
+	mesh->mNumUVComponents[0] = 2;
+
+	unsigned int side = 1;
+	while ((side + 1) * (side + 1) <= numVertices) side++;
+	mesh->mNumFaces = 2 * (side - 1) * (side - 1);
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+
+	unsigned int f = 0;
+	for (unsigned int y=0; y+1<side; y++) {
+		for (unsigned int x=0; x+1<side; x++) {
+			unsigned int a = y * side + x, b = a + 1, c = a + side, d = c + 1;
+			unsigned int quad[2][3] = { { a, b, c }, { b, d, c } };
+			for (int t=0; t<2; t++, f++) {
+				mesh->mFaces[f].mNumIndices = 3;
+				mesh->mFaces[f].mIndices = new unsigned int[3];
+				memcpy(mesh->mFaces[f].mIndices, quad[t], sizeof(quad[t]));
+			}
+		}
+	}
+	return mesh;
+}
+
+template <typename Fn>
+static double bestMs(Fn fn) {
+	double best = 1e30;
+	for (int r=0; r<RUNS; r++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		fn();
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+int main(int argc, char ** argv) {
+
+	unsigned int numVertices = argc > 1 ? (unsigned int) atoi(argv[1]) : 4000000;
+	aiMesh * mesh = makeMesh(numVertices);
+
+	vector<Vertex> legacyVertices, bulkVertices;
+	vector<unsigned int> legacyIndices, bulkIndices;
+
+	double legacy = bestMs([&] {
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		legacyExtract(mesh, vertices, indices);
+		legacyVertices.swap(vertices);
+		legacyIndices.swap(indices);
+	});
+	double bulk = bestMs([&] {
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
+		ExtractVertices(mesh, vertices);
+		ExtractIndices(mesh, indices);
+		bulkVertices.swap(vertices);
+		bulkIndices.swap(indices);
+	});
+
+	bool same = legacyIndices == bulkIndices && legacyVertices.size() == bulkVertices.size() &&
+		memcmp(legacyVertices.data(), bulkVertices.data(), legacyVertices.size() * sizeof(Vertex)) == 0;
+
+	cout << mesh->mNumVertices << " vertices, " << mesh->mNumFaces << " faces\n";
+	cout << "per-vertex loop: " << legacy << " ms\n";
+	cout << "MeshImport:      " << bulk << " ms (" << legacy / bulk << "x)\n";
+	cout << "results " << (same ? "match" : "DIFFER") << "\n";
+
+	delete mesh;
+	return same ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/**
+* Mesh optimization report: imports every model under the given directories
+* (default: Resources) the same way Model::loadModel does and prints the
+* post-transform cache ACMR / ATVR before and after OptimizeMesh.
+*
+* Build from the repository root:
+*   g++ -std=c++14 -O2 -I. -Icommon/includes utils/meshstats.cpp MeshOptimizer.cpp -lassimp -o meshstats
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <MeshOptimizer.h>
+
+static bool IsModel(const std::string & path) {
+	static const char * extensions[] = { ".obj", ".fbx", ".dae", ".3ds", ".blend" };
+	for (const char * ext : extensions) {
+		std::string e(ext);
+		if (path.size() > e.size() && path.compare(path.size() - e.size(), e.size(), e) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void ListModels(const std::string & dir, std::vector<std::string> & files) {
+	DIR * d = opendir(dir.c_str());
+	if (!d) return;
+	while (struct dirent * entry = readdir(d)) {
+		std::string name = entry->d_name;
+		if (name == "." || name == "..") continue;
+		std::string path = dir + "/" + name;
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) continue;
+		if (S_ISDIR(st.st_mode)) ListModels(path, files);
+		else if (IsModel(path)) files.push_back(path);
+	}
+	closedir(d);
+}
+
+static void Accumulate(VertexCacheStats & total, const VertexCacheStats & stats) {
+	total.transformed += stats.transformed;
+	total.triangles   += stats.triangles;
+	total.vertices    += stats.vertices;
+}
+
+int main(int argc, char ** argv) {
+
+	std::vector<std::string> dirs;
+	for (int i=1; i<argc; i++) dirs.push_back(argv[i]);
+	if (dirs.empty()) dirs.push_back("Resources");
+
+	std::vector<std::string> files;
+	for (const std::string & dir : dirs) ListModels(dir, files);
+	if (files.empty()) {
+		std::cerr << "meshstats: no models found\n";
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (const std::string & file : files) {
+
+		Assimp::Importer importer;
+		const aiScene * scene = importer.ReadFile(file,
+			aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+			std::cerr << file << ": " << importer.GetErrorString() << "\n";
+			continue;
+		}
+
+		VertexCacheStats before = {}, after = {};
+		double ms = 0.0;
+
+		for (unsigned int m=0; m<scene->mNumMeshes; m++) {
+			const aiMesh * mesh = scene->mMeshes[m];
+
+			// Only positions matter for the optimizer, the rest of Vertex stays default
+			std::vector<Vertex> vertices(mesh->mNumVertices);
+			for (unsigned int i=0; i<mesh->mNumVertices; i++)
+				vertices[i].position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+
+			std::vector<unsigned int> indices;
+			bool triangles = true;
+			for (unsigned int i=0; i<mesh->mNumFaces; i++) {
+				const aiFace & face = mesh->mFaces[i];
+				for (unsigned int j=0; j<face.mNumIndices; j++)
+					indices.push_back(face.mIndices[j]);
+				if (face.mNumIndices != 3) triangles = false;
+			}
+			if (!triangles) continue;
+
+			Accumulate(before, AnalyzeVertexCache(indices, vertices.size()));
+
+			auto start = std::chrono::steady_clock::now();
+			OptimizeMesh(vertices, indices);
+			ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			Accumulate(after, AnalyzeVertexCache(indices, vertices.size()));
+		}
+
+		std::cout << file << "\n"
+			<< "  triangles " << before.triangles << "  vertices " << before.vertices << "\n"
+			<< "  ACMR " << before.ACMR() << " -> " << after.ACMR()
+			<< "  ATVR " << before.ATVR() << " -> " << after.ATVR()
+			<< "  (" << ms << " ms)\n";
+	}
+
+	return 0;
+}
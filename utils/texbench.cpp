@@ -0,0 +1,104 @@
+/**
+* Texture decode benchmark: decodes every image under the given directories
+* (default: Resources) with 1, 2, 4 and N worker threads, the same way
+* LoadTextureAsync fans decoding out to its ThreadPool.
+*
+* Build from the repository root:
+*   g++ -std=c++14 -O2 -pthread -I. -Icommon/includes utils/texbench.cpp ThreadPool.cpp -o texbench
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image/stb_image.h>
+
+#include <ThreadPool.h>
+
+using namespace std;
+
+static bool isImage(const string & name) {
+	string ext = name.substr(name.find_last_of('.') + 1);
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "tga" || ext == "bmp";
+}
+
+static void listImages(const string & dir, vector<string> & files) {
+
+	DIR * d = opendir(dir.c_str());
+	if (!d) return;
+
+	struct dirent * entry;
+	while ((entry = readdir(d)) != NULL) {
+		string name = entry->d_name;
+		if (name == "." || name == "..") continue;
+
+		string path = dir + "/" + name;
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0) continue;
+
+		if (S_ISDIR(st.st_mode)) listImages(path, files);
+		else if (isImage(name)) files.push_back(path);
+	}
+
+	closedir(d);
+}
+
+static double decodeAll(const vector<string> & files, unsigned int numThreads, size_t & bytes) {
+
+	atomic<size_t> decoded(0);
+	auto start = chrono::steady_clock::now();
+
+	{
+		ThreadPool pool(numThreads);
+		for (const string & file : files) {
+			pool.Submit([&decoded, file] {
+				int width, height, nrComponents;
+				unsigned char * data = stbi_load(file.c_str(), &width, &height, &nrComponents, 0);
+				if (data) decoded += (size_t) width * height * nrComponents;
+				stbi_image_free(data);
+			});
+		}
+		pool.Wait();
+	}
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	bytes = decoded;
+	return elapsed.count();
+}
+
+int main(int argc, char ** argv) {
+
+	vector<string> dirs;
+	for (int i=1; i<argc; i++) dirs.push_back(argv[i]);
+	if (dirs.empty()) dirs.push_back("Resources");
+
+	vector<string> files;
+	for (const string & dir : dirs) listImages(dir, files);
+	if (files.empty()) {
+		cerr << "texbench: no images found\n";
+		return 1;
+	}
+
+	vector<unsigned int> threads = { 1, 2, 4 };
+	unsigned int n = ThreadPool::HardwareThreads();
+	if (find(threads.begin(), threads.end(), n) == threads.end()) threads.push_back(n);
+
+	cout << files.size() << " images\n";
+	double baseline = 0.0;
+	for (unsigned int t : threads) {
+		size_t bytes = 0;
+		double ms = decodeAll(files, t, bytes);
+		if (t == 1) baseline = ms;
+		cout << "threads: " << t << "\t" << ms << " ms\t"
+			<< bytes / (1024.0 * 1024.0) << " MB decoded\tspeedup: " << baseline / ms << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,251 @@
+/**
+* Uniform upload benchmark: opens a hidden GL window, loads the HDR and
+* PointShadow programs and times the uniform uploads of one of their frames,
+* set by name and through UniformHandles, averaged over many frames. Every
+* value changes from one frame to the next, so the uniform shadow skips
+* nothing and both sides pay for real glUniform calls.
+*
+* Build from the repository root (macOS, like the Makefile):
+*   g++ -std=c++14 -O2 -framework opengl -I. -Icommon/includes -Lcommon/lib \
+*     utils/uniformbench.cpp ShaderProgram.cpp -lglfw -lglad -o uniformbench
+*   ./uniformbench [frames]
+*/
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <ShaderProgram.h>
+
+// Average CPU time of one frame's uploads, by name and through handles.
+// Each side runs frames times, bracketed by glFinish so queued GL work is not
+// charged to the other. Both get a frame number that never repeats, to derive
+// their values from, and the upload counters show what the shadow skipped.
+template <typename ByName, typename ByHandle>
+static void BenchmarkUniforms(const char * label, ByName byName, ByHandle byHandle, int frames) {
+
+	typedef std::chrono::steady_clock Clock;
+	int frame = 0;
+
+	// Warm up: the by-name path caches locations on first use
+	byName(frame++);
+	byHandle(frame++);
+	glFinish();
+
+	ResetUniformStats();
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < frames; i++)
+		byName(frame++);
+	glFinish();
+	Clock::time_point middle = Clock::now();
+	UniformStats names = GetUniformStats();
+
+	ResetUniformStats();
+	for (int i = 0; i < frames; i++)
+		byHandle(frame++);
+	glFinish();
+	Clock::time_point end = Clock::now();
+	UniformStats handles = GetUniformStats();
+
+	std::chrono::duration<double, std::micro> nameTime = middle - start, handleTime = end - middle;
+	std::cout << label << ": uniform upload "
+		<< nameTime.count() / frames << " us/frame by name ("
+		<< names.issued / frames << " issued, " << names.skipped / frames << " skipped), "
+		<< handleTime.count() / frames << " us/frame by handle ("
+		<< handles.issued / frames << " issued, " << handles.skipped / frames << " skipped)\n";
+}
+
+// Camera and light state of one frame, different in every field from the
+// frames before and after it
+struct FrameValues {
+	bool flag;
+	float scalar;
+	glm::vec3 position, front, lightPos;
+	glm::mat4 view, projection, model;
+
+	explicit FrameValues(int frame) {
+		float t = frame * 0.001f;
+		flag = frame & 1;
+		scalar = 1.0f + t;
+		position = glm::vec3(t, 0.0f, 5.0f);
+		front = glm::normalize(glm::vec3(t, 0.0f, -1.0f));
+		lightPos = glm::vec3(0.0f, t, 0.0f);
+		view = glm::lookAt(position, position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+		projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f + t);
+		model = glm::translate(glm::mat4(1.0f), lightPos);
+	}
+};
+
+static void BenchmarkHDR(int frames) {
+
+	Shader objectShader("shaders/hdrLighting.vert", "shaders/hdrLighting.frag");
+	Shader hdrShader("shaders/hdr.vert", "shaders/hdr.frag");
+
+	UniformHandle uEnableBlinn        = objectShader.uniformHandle("uEnableBlinn");
+	UniformHandle uEnableTorch        = objectShader.uniformHandle("uEnableTorch");
+	UniformHandle uEnableNormal       = objectShader.uniformHandle("uEnableNormal");
+	UniformHandle uGamma              = objectShader.uniformHandle("uGamma");
+	UniformHandle uHeightScale        = objectShader.uniformHandle("uHeightScale");
+	UniformHandle uReverseNormal      = objectShader.uniformHandle("uReverseNormal");
+	UniformHandle uView               = objectShader.uniformHandle("uView");
+	UniformHandle uProjection         = objectShader.uniformHandle("uProjection");
+	UniformHandle uCameraPos          = objectShader.uniformHandle("uCameraPos");
+	UniformHandle uSpotLightPosition  = objectShader.uniformHandle("uSpotLight.position");
+	UniformHandle uSpotLightDirection = objectShader.uniformHandle("uSpotLight.direction");
+	UniformHandle uModel              = objectShader.uniformHandle("uModel");
+	UniformHandle uHDRBuffer          = hdrShader.uniformHandle("uHDRBuffer");
+	UniformHandle uHDR                = hdrShader.uniformHandle("uHDR");
+	UniformHandle uExposure           = hdrShader.uniformHandle("uExposure");
+
+	BenchmarkUniforms("HDR",
+		[&](int frame) {
+			FrameValues v(frame);
+			objectShader.use();
+			objectShader.setUniform("uEnableBlinn", v.flag);
+			objectShader.setUniform("uEnableTorch", !v.flag);
+			objectShader.setUniform("uEnableNormal", v.flag);
+			objectShader.setUniform("uGamma", v.flag);
+			objectShader.setUniform("uHeightScale", v.scalar);
+			objectShader.setUniform("uReverseNormal", v.flag);
+			objectShader.setUniform("uView", v.view);
+			objectShader.setUniform("uProjection", v.projection);
+			objectShader.setUniform("uCameraPos", v.position);
+			objectShader.setUniform("uSpotLight.position", v.position);
+			objectShader.setUniform("uSpotLight.direction", v.front);
+			objectShader.setUniform("uModel", v.model);
+			hdrShader.use();
+			hdrShader.setUniform("uHDRBuffer", v.flag ? 1 : 0);
+			hdrShader.setUniform("uHDR", v.flag);
+			hdrShader.setUniform("uExposure", v.scalar);
+		},
+		[&](int frame) {
+			FrameValues v(frame);
+			objectShader.use();
+			objectShader.setUniform(uEnableBlinn, v.flag);
+			objectShader.setUniform(uEnableTorch, !v.flag);
+			objectShader.setUniform(uEnableNormal, v.flag);
+			objectShader.setUniform(uGamma, v.flag);
+			objectShader.setUniform(uHeightScale, v.scalar);
+			objectShader.setUniform(uReverseNormal, v.flag);
+			objectShader.setUniform(uView, v.view);
+			objectShader.setUniform(uProjection, v.projection);
+			objectShader.setUniform(uCameraPos, v.position);
+			objectShader.setUniform(uSpotLightPosition, v.position);
+			objectShader.setUniform(uSpotLightDirection, v.front);
+			objectShader.setUniform(uModel, v.model);
+			hdrShader.use();
+			hdrShader.setUniform(uHDRBuffer, v.flag ? 1 : 0);
+			hdrShader.setUniform(uHDR, v.flag);
+			hdrShader.setUniform(uExposure, v.scalar);
+		},
+		frames);
+}
+
+static void BenchmarkPointShadow(int frames) {
+
+	Shader objectShader, simpleDepthShader;
+	objectShader.loadShaders(
+		"shaders/point_shadow.vert",
+		"shaders/point_shadow.frag");
+	simpleDepthShader.loadShaders(
+		"shaders/point_shadow_map.vert",
+		"shaders/point_shadow_map.frag",
+		"shaders/point_shadow_map.geom");
+
+	UniformHandle uDepthFarPlane      = simpleDepthShader.uniformHandle("uFarPlane");
+	UniformHandle uDepthLightPos      = simpleDepthShader.uniformHandle("uLightPos");
+	UniformHandle uShadowMatrices     = simpleDepthShader.uniformHandle("uShadowMatrices");
+	UniformHandle uView               = objectShader.uniformHandle("uView");
+	UniformHandle uProjection         = objectShader.uniformHandle("uProjection");
+	UniformHandle uCameraPos          = objectShader.uniformHandle("uCameraPos");
+	UniformHandle uBlinn              = objectShader.uniformHandle("uBlinn");
+	UniformHandle uGamma              = objectShader.uniformHandle("uGamma");
+	UniformHandle uTorch              = objectShader.uniformHandle("uTorch");
+	UniformHandle uFarPlane           = objectShader.uniformHandle("uFarPlane");
+	UniformHandle uPointLightPosition = objectShader.uniformHandle("uPointLight.position");
+	UniformHandle uSpotLightPosition  = objectShader.uniformHandle("uSpotLight.position");
+	UniformHandle uSpotLightDirection = objectShader.uniformHandle("uSpotLight.direction");
+
+	glm::mat4 shadowTransforms[6];
+
+	BenchmarkUniforms("PointShadow",
+		[&](int frame) {
+			FrameValues v(frame);
+			for (int i = 0; i < 6; i++)
+				shadowTransforms[i] = glm::translate(v.projection, glm::vec3((float) i));
+			simpleDepthShader.use();
+			simpleDepthShader.setUniform("uFarPlane", v.scalar);
+			simpleDepthShader.setUniform("uLightPos", v.lightPos);
+			simpleDepthShader.setUniform("uShadowMatrices", shadowTransforms, 6);
+			objectShader.use();
+			objectShader.setUniform("uView", v.view);
+			objectShader.setUniform("uProjection", v.projection);
+			objectShader.setUniform("uCameraPos", v.position);
+			objectShader.setUniform("uBlinn", v.flag);
+			objectShader.setUniform("uGamma", v.flag);
+			objectShader.setUniform("uTorch", !v.flag);
+			objectShader.setUniform("uFarPlane", v.scalar);
+			objectShader.setUniform("uPointLight.position", v.lightPos);
+			objectShader.setUniform("uSpotLight.position", v.position);
+			objectShader.setUniform("uSpotLight.direction", v.front);
+		},
+		[&](int frame) {
+			FrameValues v(frame);
+			for (int i = 0; i < 6; i++)
+				shadowTransforms[i] = glm::translate(v.projection, glm::vec3((float) i));
+			simpleDepthShader.use();
+			simpleDepthShader.setUniform(uDepthFarPlane, v.scalar);
+			simpleDepthShader.setUniform(uDepthLightPos, v.lightPos);
+			simpleDepthShader.setUniform(uShadowMatrices, shadowTransforms, 6);
+			objectShader.use();
+			objectShader.setUniform(uView, v.view);
+			objectShader.setUniform(uProjection, v.projection);
+			objectShader.setUniform(uCameraPos, v.position);
+			objectShader.setUniform(uBlinn, v.flag);
+			objectShader.setUniform(uGamma, v.flag);
+			objectShader.setUniform(uTorch, !v.flag);
+			objectShader.setUniform(uFarPlane, v.scalar);
+			objectShader.setUniform(uPointLightPosition, v.lightPos);
+			objectShader.setUniform(uSpotLightPosition, v.position);
+			objectShader.setUniform(uSpotLightDirection, v.front);
+		},
+		frames);
+}
+
+int main(int argc, char ** argv) {
+
+	int frames = argc > 1 ? std::atoi(argv[1]) : 1000;
+	if (frames <= 0) frames = 1000;
+
+	if (!glfwInit()) return 1;
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	GLFWwindow * window = glfwCreateWindow(64, 64, "uniformbench", NULL, NULL);
+	if (!window) {
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+		glfwTerminate();
+		return 1;
+	}
+
+	BenchmarkHDR(frames);
+	BenchmarkPointShadow(frames);
+
+	glfwTerminate();
+	return 0;
+}